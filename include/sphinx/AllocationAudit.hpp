@@ -0,0 +1,94 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+
+#include "sphinx/RecognizerConfig.hpp"
+
+namespace sphinx {
+	
+	/** @brief headless audit of heap allocations on the decode thread in steady state, separating wrapper allocations (operator new) from pocketsphinx internals (malloc), needs a build with SPHINX_COUNT_ALLOCATIONS */
+	class AllocationAudit
+	{
+	  public:
+		
+		/** @brief steady-state allocations with one event handler */
+		struct Result
+		{
+			std::string		handler;		//!< "basic", "segment" or "confidence"
+			bool			outputs;		//!< result sink and result ring attached
+			size_t			blocks;			//!< blocks decoded after warm-up
+			size_t			utterances;		//!< utterances delivered after warm-up
+			uint64_t		wrapperAllocs;	//!< operator new calls on decode thread after warm-up
+			uint64_t		wrapperBytes;	//!< bytes requested through operator new
+			uint64_t		decoderAllocs;	//!< malloc family calls not made by operator new, glibc only
+			uint64_t		decoderBytes;	//!< bytes requested through those calls
+		};
+		
+	  private:
+		
+		RecognizerConfig		mConfig;		//!< decoder configuration
+		std::string				mJsgf;			//!< grammar decoded against
+		std::vector<int16_t>	mAudio;			//!< 16 kHz mono int16 audio, decoded once to warm up then measured
+		size_t					mBlockFrames;	//!< frames per source block
+		size_t					mPasses;		//!< measured repetitions of audio
+		bool					mOutputs;		//!< attach result sink and ring flag
+		
+	  public:
+		
+		/** @brief constructor, audio defaults to 20 seconds of generated speech-like signal */
+		AllocationAudit(const RecognizerConfig& config, const std::string& jsgfData);
+		
+		/** @brief constructor using "en-us", "cmudict-en-us.dict" and "demo.jsgf" from sample assets directory */
+		AllocationAudit(const ci::fs::path& assetsPath);
+		
+		/** @brief replaces audio with raw or WAV 16 kHz mono int16 recording */
+		AllocationAudit& audio(const ci::fs::path& audioPath);
+		
+		/** @brief sets frames per source block, defaults to 320 (20 ms) */
+		AllocationAudit& blockFrames(size_t frames) { mBlockFrames = frames > 0 ? frames : 1; return *this; }
+		
+		/** @brief sets measured repetitions of audio after the warm-up pass, defaults to 3 */
+		AllocationAudit& passes(size_t count) { mPasses = count > 0 ? count : 1; return *this; }
+		
+		/** @brief sets whether each run also publishes to a binary result sink on /dev/null and a result ring with 100 ms partials, defaults to true */
+		AllocationAudit& outputs(bool enable) { mOutputs = enable; return *this; }
+		
+		/** @brief decodes audio through the recognizer runner with each built-in event handler */
+		std::vector<Result> run() const;
+		
+		/** @brief throws if counting is not compiled in, no utterance was delivered, or the wrapper allocated in steady state */
+		static void check(const std::vector<Result>& results);
+		
+		/** @brief writes results as CSV */
+		static void writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,55 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace sphinx {
+	
+	/** @brief per-thread heap allocation counts, active only when built with SPHINX_COUNT_ALLOCATIONS (which replaces global operator new/delete, and on glibc also malloc, calloc and realloc) */
+	class AllocationCounter
+	{
+	  public:
+		
+		/** @brief returns true if allocation counting is compiled in */
+		static bool isEnabled();
+		
+		/** @brief returns number of operator new calls made by calling thread */
+		static uint64_t getThreadCount();
+		
+		/** @brief returns bytes requested through operator new by calling thread */
+		static uint64_t getThreadBytes();
+		
+		/** @brief returns true if malloc family counting is compiled in */
+		static bool isMallocEnabled();
+		
+		/** @brief returns number of malloc, calloc and realloc calls made by calling thread, including those made by operator new */
+		static uint64_t getThreadMallocCount();
+		
+		/** @brief returns bytes requested through malloc, calloc and realloc by calling thread */
+		static uint64_t getThreadMallocBytes();
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,129 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+
+#include "cinder/audio/Buffer.h"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class AudioSource>			AudioSourceRef;
+	typedef std::shared_ptr<class AudioSourcePcm>		AudioSourcePcmRef;
+	
+	/** @brief audio source abstract base class, read from the recognizer thread */
+	class AudioSource
+	{
+	  public:
+		
+		/** @brief sample representation of source blocks */
+		enum class SampleType { Float, Int16 };
+		
+		/** @brief block of source audio, valid until next read */
+		struct Block
+		{
+			const ci::audio::Buffer*	buffer;			//!< non-interleaved float audio, for float sources
+			const int16_t*				pcm;			//!< interleaved int16 audio, for int16 sources
+			size_t						numFrames;		//!< frames in block
+			size_t						droppedBlocks;	//!< blocks lost since previous block
+			size_t						droppedFrames;	//!< frames lost since previous block
+			bool						discontinuity;	//!< audio before block was discarded and utterance in progress should be too
+		};
+		
+		/** @brief virtual destructor */
+		virtual ~AudioSource() { /* no-op */ }
+		
+		/** @brief returns source sample rate */
+		virtual size_t getSampleRate() const = 0;
+		
+		/** @brief returns source channel count */
+		virtual size_t getNumChannels() const = 0;
+		
+		/** @brief returns source sample representation */
+		virtual SampleType getSampleType() const = 0;
+		
+		/** @brief returns most frames one block can hold */
+		virtual size_t getMaxFramesPerBlock() const = 0;
+		
+		/** @brief waits for next block, returns false once source is exhausted or interrupted */
+		virtual bool read(Block* block) = 0;
+		
+		/** @brief wakes a waiting read so the reader can stop */
+		virtual void interrupt() { /* no-op */ }
+		
+		/** @brief returns frames buffered ahead of reader */
+		virtual size_t getQueuedFrames() const { return 0; }
+		
+		/** @brief returns true if source delivers 16 kHz mono int16, which is decoded without conversion or copying */
+		bool isDecoderFormat() const { return getSampleType() == SampleType::Int16 && getSampleRate() == 16000 && getNumChannels() == 1; }
+	};
+	
+	/** @brief audio source reading interleaved int16 PCM from memory in fixed-size blocks, without copying */
+	class AudioSourcePcm : public AudioSource
+	{
+	  private:
+		
+		std::vector<int16_t>	mOwned;			//!< owned samples, if any
+		const int16_t*			mData;			//!< interleaved samples
+		size_t					mNumFrames;		//!< total frames
+		size_t					mSampleRate;	//!< sample rate
+		size_t					mNumChannels;	//!< channel count
+		size_t					mBlockFrames;	//!< frames per block
+		bool					mRealtime;		//!< pace reads at sample rate flag
+		size_t					mPosition;		//!< next frame
+		
+		std::chrono::steady_clock::time_point mStartTime;	//!< time of first read, when paced
+		
+		/** @brief private constructor */
+		AudioSourcePcm(const int16_t* data, size_t numFrames, size_t sampleRate, size_t numChannels);
+		
+	  public:
+		
+		/** @brief static creational method, data must outlive source */
+		static AudioSourcePcmRef create(const int16_t* data, size_t numFrames, size_t sampleRate = 16000, size_t numChannels = 1)
+		{
+			return AudioSourcePcmRef( new AudioSourcePcm( data, numFrames, sampleRate, numChannels ) );
+		}
+		
+		/** @brief static creational method, takes ownership of samples */
+		static AudioSourcePcmRef create(std::vector<int16_t>&& samples, size_t sampleRate = 16000, size_t numChannels = 1);
+		
+		/** @brief sets frames per block, defaults to 20 ms */
+		AudioSourcePcm& blockFrames(size_t frames) { mBlockFrames = frames > 0 ? frames : 1; return *this; }
+		
+		/** @brief paces reads at sample rate as a live source would, otherwise reads as fast as possible, defaults to false */
+		AudioSourcePcm& realtime(bool enabled) { mRealtime = enabled; return *this; }
+		
+		size_t getSampleRate() const { return mSampleRate; }
+		size_t getNumChannels() const { return mNumChannels; }
+		SampleType getSampleType() const { return SampleType::Int16; }
+		size_t getMaxFramesPerBlock() const { return mBlockFrames; }
+		bool read(Block* block);
+	};
+	
+} // namespace sphinx
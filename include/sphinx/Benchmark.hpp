@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "cinder/Filesystem.h"
+
+#include "sphinx/RecognizerConfig.hpp"
+
+namespace sphinx {
+	
+	/** @brief headless benchmark of model loading, grammar compilation and decode throughput, needs no audio device */
+	class Benchmark
+	{
+	  public:
+		
+		/** @brief multi-stream throughput at one thread count */
+		struct Throughput
+		{
+			size_t		threads;		//!< concurrent decoders
+			double		wallSeconds;	//!< time to decode all streams
+			double		audioPerSec;	//!< audio seconds decoded per wall second, summed over streams
+			double		rtf;			//!< mean CPU seconds per audio second per stream
+		};
+		
+		/** @brief benchmark measurements */
+		struct Result
+		{
+			double					audioSeconds;		//!< benchmark audio duration
+			double					modelLoadMs;		//!< decoder creation time
+			double					grammarCompileMs;	//!< JSGF parse, FSG build and search setup time
+			double					rtf;				//!< single-stream CPU seconds per audio second
+			double					wallRtf;			//!< single-stream wall seconds per audio second
+			double					finalizeMs;			//!< single-stream mean ps_end_utt time
+			std::vector<Throughput>	throughput;			//!< multi-stream results by thread count
+			size_t					peakRssKb;			//!< process peak resident set size
+		};
+		
+	  private:
+		
+		RecognizerConfig		mConfig;		//!< decoder configuration
+		std::string				mJsgf;			//!< grammar decoded against
+		std::vector<int16_t>	mAudio;			//!< 16 kHz mono int16 audio
+		std::vector<size_t>		mThreadCounts;	//!< thread counts for multi-stream runs
+		size_t					mUttSamples;	//!< utterance length audio is split into
+		
+	  public:
+		
+		/** @brief constructor, benchmark audio defaults to 30 seconds of generated speech-like signal */
+		Benchmark(const RecognizerConfig& config, const std::string& jsgfData);
+		
+		/** @brief constructor using "en-us", "cmudict-en-us.dict" and "demo.jsgf" from sample assets directory */
+		Benchmark(const ci::fs::path& assetsPath);
+		
+		/** @brief replaces benchmark audio with raw or WAV 16 kHz mono int16 recording */
+		Benchmark& audio(const ci::fs::path& audioPath);
+		
+		/** @brief replaces benchmark audio with generated signal of given duration */
+		Benchmark& generate(double seconds);
+		
+		/** @brief sets thread counts for multi-stream runs, defaults to powers of two up to hardware concurrency */
+		Benchmark& threads(const std::vector<size_t>& counts) { mThreadCounts = counts; return *this; }
+		
+		/** @brief sets utterance length audio is split into, defaults to 5 seconds */
+		Benchmark& utteranceMs(size_t ms) { mUttSamples = std::max<size_t>( 16 * ms, 1600 ); return *this; }
+		
+		/** @brief runs benchmark */
+		Result run() const;
+		
+		/** @brief writes result as JSON */
+		static void writeReport(const Result& result, const ci::fs::path& jsonPath);
+		
+		/** @brief fills output with deterministic 16 kHz speech-like signal, alternating voiced syllables and near-silence */
+		static void generateSpeechLike(double seconds, std::vector<int16_t>* output);
+		
+		/** @brief returns process peak resident set size in kilobytes */
+		static size_t getPeakRssKb();
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,221 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "sphinx/AudioSource.hpp"
+
+#include "cinder/audio/Node.h"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class CaptureQueue>	CaptureQueueRef;
+	typedef std::shared_ptr<class CaptureNode>	CaptureNodeRef;
+	
+	/** @brief bounded queue of fixed-size audio blocks between a capture producer and the recognizer, with explicit overflow policy, handing slots over through atomics so only Overflow::Block ever waits on a lock */
+	class CaptureQueue : public AudioSource
+	{
+	  public:
+		
+		/** @brief behavior when producer finds queue full */
+		enum class Overflow
+		{
+			Block,			//!< wait for space, for producers that may stall (never the audio thread)
+			DropOldest,		//!< discard oldest queued block
+			DropNewest,		//!< discard incoming block
+			SkipToLive		//!< discard all queued blocks and reset the utterance in progress
+		};
+		
+		/** @brief queue format */
+		class Format
+		{
+		  private:
+			
+			size_t		mSampleRate;	//!< sample rate
+			size_t		mNumChannels;	//!< channel count
+			SampleType	mSampleType;	//!< stored sample representation
+			size_t		mBlockFrames;	//!< frames per block
+			size_t		mCapacity;		//!< queued blocks before overflow
+			Overflow	mOverflow;		//!< overflow policy
+			
+		  public:
+			
+			/** @brief default constructor, 16 kHz mono int16 in 20 ms blocks, one second deep, dropping oldest */
+			Format() : mSampleRate( 16000 ), mNumChannels( 1 ), mSampleType( SampleType::Int16 ), mBlockFrames( 320 ), mCapacity( 50 ), mOverflow( Overflow::DropOldest ) { /* no-op */ }
+			
+			Format& sampleRate(size_t value) { mSampleRate = value; return *this; }
+			Format& channels(size_t value) { mNumChannels = value > 0 ? value : 1; return *this; }
+			Format& sampleType(SampleType value) { mSampleType = value; return *this; }
+			Format& blockFrames(size_t value) { mBlockFrames = value > 0 ? value : 1; return *this; }
+			Format& capacity(size_t value) { mCapacity = value > 0 ? value : 1; return *this; }
+			Format& overflow(Overflow value) { mOverflow = value; return *this; }
+			
+			size_t getSampleRate() const { return mSampleRate; }
+			size_t getNumChannels() const { return mNumChannels; }
+			SampleType getSampleType() const { return mSampleType; }
+			size_t getBlockFrames() const { return mBlockFrames; }
+			size_t getCapacity() const { return mCapacity; }
+			Overflow getOverflow() const { return mOverflow; }
+		};
+		
+		/** @brief queue counters */
+		struct Metrics
+		{
+			uint64_t	droppedBlocks;		//!< blocks discarded on overflow
+			uint64_t	droppedFrames;		//!< frames discarded on overflow
+			uint64_t	resets;				//!< skip-to-live resets
+			double		blockedSeconds;		//!< time producer spent waiting for space
+			size_t		queuedBlocks;		//!< blocks awaiting read
+			size_t		maxQueuedBlocks;	//!< most blocks awaiting read
+		};
+		
+	  private:
+		
+		Format								mFormat;		//!< queue format
+		std::vector<ci::audio::Buffer>		mFloatSlots;	//!< float block storage, allocated once
+		std::vector<int16_t>				mPcmSlots;		//!< int16 block storage, allocated once
+		std::vector<size_t>					mSlotFrames;	//!< frames held by each slot
+		std::vector<uint64_t>				mSlotSequence;	//!< block sequence number of each slot
+		std::vector<uint64_t>				mSlotDiscarded;	//!< incoming blocks discarded before each slot, cumulative
+		std::vector<uint64_t>				mSlotDiscardedFrames;	//!< incoming frames discarded before each slot, cumulative
+		std::vector<uint64_t>				mSlotResets;	//!< skip to live resets before each slot, cumulative
+		
+		// Queued slots, a ring the producer appends to and both sides pop from, the producer only to drop oldest:
+		std::vector<std::atomic<size_t> >	mQueued;		//!< queued slot indices, ring
+		std::atomic<uint64_t>				mQueueHead;		//!< count of slots popped, advanced by compare and swap
+		std::atomic<uint64_t>				mQueueTail;		//!< count of slots queued, advanced by producer
+		
+		// Slots released by the reader, a ring the producer drains:
+		std::vector<std::atomic<size_t> >	mReturned;		//!< released slot indices, ring
+		std::atomic<uint64_t>				mReturnTail;	//!< count of slots released, advanced by reader
+		uint64_t							mReturnHead;	//!< count of released slots drained, producer only
+		
+		// Producer state:
+		std::vector<size_t>					mFree;			//!< free slot indices, reserved for every slot
+		size_t								mWriting;		//!< slot being filled, or none
+		size_t								mFill;			//!< frames written to current slot, or to discarded block
+		bool								mDiscarding;	//!< current incoming block is being dropped flag
+		uint64_t							mNextSequence;	//!< sequence number of next queued block
+		uint64_t							mDiscarded;		//!< incoming blocks discarded so far
+		uint64_t							mDiscardedFrames;	//!< incoming frames discarded so far
+		uint64_t							mResets;		//!< skip to live resets so far
+		
+		// Reader state:
+		size_t								mHeld;			//!< slot returned by last read, or none
+		uint64_t							mReadSequence;	//!< sequence number expected next
+		uint64_t							mReadDiscarded;	//!< discarded blocks already reported
+		uint64_t							mReadDiscardedFrames;	//!< discarded frames already reported
+		uint64_t							mReadResets;	//!< resets already reported
+		
+		std::atomic<bool>					mClosed;		//!< producer finished flag
+		std::atomic<bool>					mInterrupted;	//!< reads and writes abandoned flag
+		
+		// Waiting, the mutex is never taken by a non-blocking producer:
+		std::mutex							mMutex;			//!< guards waits only
+		std::condition_variable				mReadCv;		//!< signals queued block or close
+		std::condition_variable				mWriteCv;		//!< signals free slot, for Overflow::Block
+		
+		// Counters, written by producer:
+		std::atomic<uint64_t>				mDroppedBlocks;		//!< blocks discarded on overflow
+		std::atomic<uint64_t>				mDroppedFrames;		//!< frames discarded on overflow
+		std::atomic<uint64_t>				mResetCount;		//!< skip-to-live resets
+		std::atomic<uint64_t>				mBlockedMicros;		//!< time producer spent waiting for space
+		std::atomic<size_t>					mMaxQueued;			//!< most blocks awaiting read
+		
+		/** @brief private constructor */
+		CaptureQueue(const Format& format);
+		
+		/** @brief returns blocks awaiting read */
+		size_t queuedBlocks() const { return size_t( mQueueTail.load( std::memory_order_acquire ) - mQueueHead.load( std::memory_order_acquire ) ); }
+		
+		/** @brief prepares slot for next incoming block, applying overflow policy, producer only */
+		void beginBlock();
+		
+		/** @brief queues filled slot or finishes discarded block, producer only */
+		void endBlock();
+		
+		/** @brief drops oldest queued block unless the reader takes it first, producer only, returns false once queue is empty */
+		bool dropOldest();
+		
+		/** @brief splits frames into blocks, copying each run via fn(slot, slotOffset, sourceOffset, count) */
+		template<typename Fn>
+		void write(size_t numFrames, Fn fn);
+		
+	  public:
+		
+		/** @brief static creational method */
+		static CaptureQueueRef create(const Format& format = Format()) { return CaptureQueueRef( new CaptureQueue( format ) ); }
+		
+		/** @brief appends non-interleaved float audio from the single producer, queue must have float sample type */
+		void push(const ci::audio::Buffer& buffer);
+		
+		/** @brief appends interleaved int16 audio from the single producer, queue must have int16 sample type */
+		void push(const int16_t* data, size_t numFrames);
+		
+		/** @brief queues partial block, padded with silence for float queues, and marks end of stream from the single producer, reads fail once drained */
+		void close();
+		
+		/** @brief returns queue format */
+		const Format& getFormat() const { return mFormat; }
+		
+		/** @brief returns queue counters */
+		Metrics getMetrics() const;
+		
+		/** @brief returns bytes of preallocated block storage */
+		size_t getStorageBytes() const;
+		
+		size_t getSampleRate() const { return mFormat.getSampleRate(); }
+		size_t getNumChannels() const { return mFormat.getNumChannels(); }
+		SampleType getSampleType() const { return mFormat.getSampleType(); }
+		size_t getMaxFramesPerBlock() const { return mFormat.getBlockFrames(); }
+		size_t getQueuedFrames() const;
+		bool read(Block* block);
+		void interrupt();
+	};
+	
+	/** @brief Cinder node pushing device audio into a float capture queue on the audio thread */
+	class CaptureNode : public ci::audio::NodeAutoPullable
+	{
+	  private:
+		
+		CaptureQueueRef mQueue;		//!< destination queue
+		
+	  protected:
+		
+		void process(ci::audio::Buffer* buffer) override;
+		
+	  public:
+		
+		/** @brief constructor */
+		CaptureNode(const CaptureQueueRef& queue, const Format& format = Format()) : NodeAutoPullable( format ), mQueue( queue ) { /* no-op */ }
+		
+		/** @brief returns destination queue */
+		const CaptureQueueRef& getQueue() const { return mQueue; }
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "cinder/Filesystem.h"
+#include "cinder/audio/Buffer.h"
+
+namespace sphinx {
+	
+	/** @brief microbenchmark of device-rate float to 16 kHz int16 conversion kernels, needs no audio context */
+	class ConversionBenchmark
+	{
+	  public:
+		
+		/** @brief conversion kernel for one source format */
+		class Kernel
+		{
+		  public:
+			
+			/** @brief virtual destructor */
+			virtual ~Kernel() { /* no-op */ }
+			
+			/** @brief converts one block of device audio to decoder input */
+			virtual void process(const ci::audio::Buffer& input) = 0;
+		};
+		
+		typedef std::shared_ptr<Kernel> KernelRef;
+		
+		/** @brief creates kernel for source sample rate, channel count and block size */
+		typedef std::function<KernelRef(size_t sampleRate, size_t numChannels, size_t blockSize)> KernelFactory;
+		
+		/** @brief measurements for one kernel and source format */
+		struct Result
+		{
+			std::string		kernel;				//!< kernel name
+			size_t			sampleRate;			//!< source sample rate
+			size_t			numChannels;		//!< source channel count
+			size_t			blockSize;			//!< source frames per block
+			double			nsPerSample;		//!< nanoseconds per source frame
+			double			allocsPerBlock;		//!< heap allocations per block, when counted
+			double			bytesPerBlock;		//!< heap bytes allocated per block, when counted
+		};
+		
+	  private:
+		
+		std::vector<std::pair<std::string,KernelFactory> >	mKernels;		//!< kernels to compare
+		std::vector<size_t>									mBlockSizes;	//!< source block sizes
+		std::vector<size_t>									mSampleRates;	//!< source sample rates
+		size_t												mNumChannels;	//!< source channel count
+		double												mSeconds;		//!< source audio per measurement
+		
+	  public:
+		
+		/** @brief constructor, registers the generic "converter" path, its "converter-reuse" variant without per-block allocation, and the recognizer "resampler" */
+		ConversionBenchmark();
+		
+		/** @brief registers additional kernel */
+		ConversionBenchmark& add(const std::string& name, const KernelFactory& factory);
+		
+		/** @brief sets source block sizes, defaults to 256 through 4096 frames */
+		ConversionBenchmark& blockSizes(const std::vector<size_t>& sizes) { mBlockSizes = sizes; return *this; }
+		
+		/** @brief sets source sample rates, defaults to 44.1, 48 and 96 kHz */
+		ConversionBenchmark& sampleRates(const std::vector<size_t>& rates) { mSampleRates = rates; return *this; }
+		
+		/** @brief sets source channel count, defaults to mono */
+		ConversionBenchmark& channels(size_t count) { mNumChannels = count > 0 ? count : 1; return *this; }
+		
+		/** @brief sets source audio duration per measurement, defaults to 10 seconds */
+		ConversionBenchmark& seconds(double value) { mSeconds = value; return *this; }
+		
+		/** @brief measures every kernel at every source format */
+		std::vector<Result> run() const;
+		
+		/** @brief writes results as CSV, allocation columns are empty unless built with SPHINX_COUNT_ALLOCATIONS */
+		static void writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,159 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+
+#include <sphinxbase/mmio.h>
+
+#include "cinder/Filesystem.h"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class Dictionary>	DictionaryRef;
+	
+	/** @brief non-owning view of a single pronunciation stored in a dictionary */
+	class Pronunciation
+	{
+	  private:
+		
+		const uint8_t*	mPhones;	//!< packed phone indices
+		size_t			mSize;		//!< number of phones
+		const char*		mNames;		//!< phone name table
+		
+	  public:
+		
+		/** @brief fixed stride of a phone name table entry, including terminator */
+		static const size_t kPhoneNameSize = 8;
+		
+		/** @brief default constructor */
+		Pronunciation() : mPhones( NULL ), mSize( 0 ), mNames( NULL ) { /* no-op */ }
+		
+		/** @brief constructor */
+		Pronunciation(const uint8_t* phones, size_t size, const char* names) : mPhones( phones ), mSize( size ), mNames( names ) { /* no-op */ }
+		
+		/** @brief returns number of phones */
+		size_t size() const { return mSize; }
+		
+		/** @brief returns name of phone at index */
+		const char* operator[](size_t index) const { return mNames + mPhones[ index ] * kPhoneNameSize; }
+		
+		/** @brief writes space-separated phone string into output, returns length or 0 if output is too small */
+		size_t format(char* output, size_t outputSize) const;
+	};
+	
+	/** @brief pronunciation dictionary with perfect-hash word index, loaded from CMU text format or memory-mapped binary cache */
+	class Dictionary
+	{
+	  private:
+		
+		struct Header;
+		struct Slot;
+		
+		std::vector<uint32_t>	mImage;			//!< owned image when built from text (word-aligned)
+		mmio_file_t*			mMapped;		//!< mapped image when loaded from cache
+		
+		const Header*			mHeader;		//!< image header
+		const uint32_t*			mDisplace;		//!< per-bucket hash displacements
+		const Slot*				mSlots;			//!< hash slots
+		const char*				mNames;			//!< phone name table
+		const char*				mWords;			//!< word string pool
+		const uint8_t*			mPhones;		//!< packed phone pool
+		
+		Dictionary(Dictionary const&) = delete;
+		Dictionary& operator=(Dictionary const&) = delete;
+		
+		/** @brief private default constructor */
+		Dictionary();
+		
+		/** @brief private text load method, keeping only entries of words in vocabulary if given, throws if file cannot be read */
+		void loadText(const ci::fs::path& dictPath, const std::unordered_set<std::string>* vocabulary = NULL);
+		
+		/** @brief private cache load method, throws if file cannot be mapped or is invalid */
+		void loadCache(const ci::fs::path& cachePath);
+		
+		/** @brief private method resolving section pointers from header, throws if image is invalid */
+		void bind(const void* image, size_t imageSize);
+		
+	  public:
+		
+		/** @brief static creational method, loads binary cache or CMU-format text file */
+		static DictionaryRef create(const ci::fs::path& dictPath)
+		{
+			DictionaryRef d = DictionaryRef( new Dictionary() );
+			if( isCache( dictPath ) )
+				d->loadCache( dictPath );
+			else
+				d->loadText( dictPath );
+			return d;
+		}
+		
+		/** @brief static creational method, loads only entries of words in vocabulary (with their alternates) from a CMU-format text file, or maps a binary cache whole */
+		static DictionaryRef create(const ci::fs::path& dictPath, const std::unordered_set<std::string>& vocabulary)
+		{
+			DictionaryRef d = DictionaryRef( new Dictionary() );
+			if( isCache( dictPath ) )
+				d->loadCache( dictPath );
+			else
+				d->loadText( dictPath, &vocabulary );
+			return d;
+		}
+		
+		/** @brief returns true if file is a binary dictionary cache */
+		static bool isCache(const ci::fs::path& path);
+		
+		/** @brief converts CMU-format text dictionary into binary cache */
+		static void writeCache(const ci::fs::path& dictPath, const ci::fs::path& cachePath);
+		
+		/** @brief destructor */
+		~Dictionary();
+		
+		/** @brief returns number of entries, including alternate pronunciations */
+		size_t size() const;
+		
+		/** @brief returns image bytes */
+		size_t getImageSize() const;
+		
+		/** @brief returns true if image is mapped from a cache rather than built in memory */
+		bool isMapped() const { return mMapped != NULL; }
+		
+		/** @brief looks up entry (alternates keyed as "word(n)") without allocating, returns false if unfound */
+		bool lookup(const char* word, size_t length, Pronunciation* output) const;
+		
+		/** @brief looks up entry without allocating, returns false if unfound */
+		bool lookup(const std::string& word, Pronunciation* output) const { return lookup( word.c_str(), word.size(), output ); }
+		
+		/** @brief returns true if word has at least one pronunciation */
+		bool contains(const std::string& word) const { return lookup( word, NULL ); }
+		
+		/** @brief writes image to file */
+		void save(const ci::fs::path& cachePath) const;
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,108 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace sphinx {
+	
+	/** @brief utterance endpointer driven by per-block voice activity, enforcing minimum speech, trailing hangover and maximum length */
+	class Endpointer
+	{
+	  public:
+		
+		/** @brief endpointer decision for a block */
+		enum class Event
+		{
+			None,		//!< no boundary
+			Start,		//!< speech began, utterance in progress
+			End,		//!< utterance ended after hangover, deliver result
+			Discard,	//!< utterance ended without enough speech, drop result
+			Cut			//!< utterance reached maximum length, deliver result
+		};
+		
+		/** @brief endpointer parameters, durations in milliseconds, zero disables a limit */
+		class Format
+		{
+		  private:
+			
+			size_t	mSampleRate;	//!< decoder sample rate
+			size_t	mMinSpeech;		//!< minimum speech duration
+			size_t	mHangover;		//!< trailing silence before utterance end
+			size_t	mMaxUtterance;	//!< maximum utterance duration
+			
+		  public:
+			
+			/** @brief default constructor, limits disabled */
+			Format() : mSampleRate( 16000 ), mMinSpeech( 0 ), mHangover( 0 ), mMaxUtterance( 0 ) { /* no-op */ }
+			
+			/** @brief sets sample rate of audio counted by endpointer */
+			Format& sampleRate(size_t hz) { mSampleRate = hz; return *this; }
+			/** @brief sets minimum speech duration, shorter utterances (clicks) are discarded */
+			Format& minSpeech(size_t ms) { mMinSpeech = ms; return *this; }
+			/** @brief sets trailing silence, in addition to decoder VAD, before an utterance ends */
+			Format& hangover(size_t ms) { mHangover = ms; return *this; }
+			/** @brief sets maximum utterance duration, after which the utterance is cut */
+			Format& maxUtterance(size_t ms) { mMaxUtterance = ms; return *this; }
+			
+			size_t getSampleRate() const { return mSampleRate; }
+			size_t getMinSpeech() const { return mMinSpeech; }
+			size_t getHangover() const { return mHangover; }
+			size_t getMaxUtterance() const { return mMaxUtterance; }
+		};
+		
+	  private:
+		
+		size_t	mMinSpeechSamples;		//!< minimum speech in samples
+		size_t	mHangoverSamples;		//!< hangover in samples
+		size_t	mMaxUttSamples;			//!< maximum utterance in samples
+		
+		bool	mInUtterance;			//!< utterance in progress flag
+		size_t	mSpeechSamples;			//!< speech samples in current utterance
+		size_t	mSilenceSamples;		//!< trailing silence samples in current utterance
+		size_t	mUttSamples;			//!< total samples in current utterance
+		
+	  public:
+		
+		/** @brief constructor */
+		Endpointer(const Format& format = Format()) { setFormat( format ); }
+		
+		/** @brief sets parameters and resets state */
+		void setFormat(const Format& format);
+		
+		/** @brief resets state to silence */
+		void reset();
+		
+		/** @brief advances by a block of decoded audio with its voice activity decision */
+		Event update(bool inSpeech, size_t numSamples);
+		
+		/** @brief returns true while an utterance is in progress */
+		bool isInUtterance() const { return mInUtterance; }
+		
+		/** @brief returns length of current utterance in samples */
+		size_t getUtteranceSamples() const { return mUttSamples; }
+	};
+	
+} // namespace sphinx
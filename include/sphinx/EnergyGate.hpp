@@ -0,0 +1,115 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace sphinx {
+	
+	/** @brief pre-decoder gate on short-term energy and zero-crossing rate with adaptive noise floor */
+	class EnergyGate
+	{
+	  public:
+		
+		/** @brief gate parameters */
+		class Format
+		{
+		  private:
+			
+			size_t	mSampleRate;		//!< input sample rate
+			float	mOpenRatio;			//!< energy over noise floor that opens gate
+			float	mFricativeRatio;	//!< energy over noise floor that opens gate on high zero-crossing rate
+			float	mZcrThreshold;		//!< zero crossings per sample considered fricative
+			float	mMinLevel;			//!< absolute RMS below which gate never opens
+			float	mFloorRise;			//!< per-block rate at which noise floor follows rising level
+			size_t	mHangover;			//!< milliseconds gate stays open after last loud block
+			
+		  public:
+			
+			/** @brief default constructor */
+			Format() : mSampleRate( 16000 ), mOpenRatio( 3.0f ), mFricativeRatio( 1.5f ), mZcrThreshold( 0.25f ), mMinLevel( 0.001f ), mFloorRise( 0.01f ), mHangover( 300 ) { /* no-op */ }
+			
+			Format& sampleRate(size_t hz) { mSampleRate = hz; return *this; }
+			Format& openRatio(float ratio) { mOpenRatio = ratio; return *this; }
+			Format& fricativeRatio(float ratio) { mFricativeRatio = ratio; return *this; }
+			Format& zcrThreshold(float rate) { mZcrThreshold = rate; return *this; }
+			Format& minLevel(float rms) { mMinLevel = rms; return *this; }
+			Format& floorRise(float rate) { mFloorRise = rate; return *this; }
+			Format& hangover(size_t ms) { mHangover = ms; return *this; }
+			
+			size_t getSampleRate() const { return mSampleRate; }
+			float getOpenRatio() const { return mOpenRatio; }
+			float getFricativeRatio() const { return mFricativeRatio; }
+			float getZcrThreshold() const { return mZcrThreshold; }
+			float getMinLevel() const { return mMinLevel; }
+			float getFloorRise() const { return mFloorRise; }
+			size_t getHangover() const { return mHangover; }
+		};
+		
+		/** @brief snapshot of gate state */
+		struct Metrics
+		{
+			bool		open;			//!< gate open flag
+			float		noiseFloor;		//!< tracked noise floor RMS
+			uint64_t	gatedSamples;	//!< samples withheld from decoder
+			uint64_t	passedSamples;	//!< samples passed to decoder
+		};
+		
+	  private:
+		
+		Format					mFormat;			//!< parameters
+		size_t					mHangoverSamples;	//!< hangover in samples
+		size_t					mQuietSamples;		//!< samples since last loud block
+		bool					mFloorValid;		//!< noise floor initialized flag
+		
+		std::atomic<bool>		mOpen;				//!< gate open flag
+		std::atomic<float>		mFloor;				//!< noise floor RMS
+		std::atomic<uint64_t>	mGated;				//!< withheld sample count
+		std::atomic<uint64_t>	mPassed;			//!< passed sample count
+		
+	  public:
+		
+		/** @brief constructor */
+		EnergyGate(const Format& format = Format());
+		
+		/** @brief analyzes block and returns true if gate is open */
+		bool update(const float* data, size_t size);
+		
+		/** @brief records block withheld from decoder */
+		void hold(size_t size) { mGated += size; }
+		
+		/** @brief records block passed to decoder */
+		void pass(size_t size) { mPassed += size; }
+		
+		/** @brief returns true if gate is open */
+		bool isOpen() const { return mOpen; }
+		
+		/** @brief returns snapshot of gate state, safe to call from any thread */
+		Metrics getMetrics() const;
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,258 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <sphinxbase/profile.h>
+
+#include "sphinx/Trace.hpp"
+
+namespace sphinx {
+	
+	//! compile-time instrumentation switch, enabled by building with SPHINX_INSTRUMENT
+#if defined( SPHINX_INSTRUMENT )
+	constexpr bool kInstrumentEnabled = true;
+#else
+	constexpr bool kInstrumentEnabled = false;
+#endif
+	
+	/** @brief registered instrument, enabled instruments link themselves into a process-wide list on construction */
+	class Instrument
+	{
+	  public:
+		
+		/** @brief instrument kind */
+		enum class Kind
+		{
+			Timer,		//!< scoped cpu and wall time
+			Counter,	//!< running total
+			Gauge		//!< last and maximum value
+		};
+		
+		/** @brief instrument reading */
+		struct Sample
+		{
+			std::string		name;			//!< instrument name
+			Kind			kind;			//!< instrument kind
+			uint64_t		count;			//!< timed scopes, additions or updates
+			double			cpuSeconds;		//!< timer cpu time
+			double			wallSeconds;	//!< timer wall time
+			int64_t			value;			//!< counter total or last gauge value
+			int64_t			max;			//!< maximum gauge value
+		};
+		
+	  private:
+		
+		const char*		mName;		//!< instrument name, a string literal
+		Kind			mKind;		//!< instrument kind
+		Instrument*		mNext;		//!< next registered instrument
+		
+	  protected:
+		
+		/** @brief constructor, registers instrument */
+		Instrument(const char* name, Kind kind);
+		
+		/** @brief fills reading */
+		virtual void sample(Sample* output) const = 0;
+		
+		/** @brief resets reading */
+		virtual void clear() = 0;
+		
+	  public:
+		
+		/** @brief returns instrument name */
+		const char* getName() const { return mName; }
+		
+		/** @brief returns readings of every registered instrument, which without SPHINX_INSTRUMENT are only those explicitly instantiated enabled */
+		static std::vector<Sample> snapshot();
+		
+		/** @brief resets every registered instrument */
+		static void reset();
+	};
+	
+	/** @brief accumulated scope timer, empty when disabled unless its name is kept for SPHINX_TRACE spans */
+	template<bool Enabled = kInstrumentEnabled>
+	class InstrumentTimer : private TraceName<>
+	{
+	  public:
+		
+		/** @brief constructor */
+		constexpr InstrumentTimer(const char* name) : TraceName<>( name ) { }
+		
+		/** @brief returns trace span name */
+		constexpr const TraceName<>& getSpanName() const { return *this; }
+	};
+	
+	template<>
+	class InstrumentTimer<true> : public Instrument
+	{
+	  private:
+		
+		std::atomic<uint64_t>	mCount;		//!< timed scopes
+		std::atomic<uint64_t>	mCpuNs;		//!< accumulated cpu time
+		std::atomic<uint64_t>	mWallNs;	//!< accumulated wall time
+		
+		void sample(Sample* output) const;
+		void clear();
+		
+	  public:
+		
+		/** @brief constructor */
+		InstrumentTimer(const char* name) : Instrument( name, Kind::Timer ), mCount( 0 ), mCpuNs( 0 ), mWallNs( 0 ) { /* no-op */ }
+		
+		/** @brief accumulates stopped sphinxbase timer */
+		void add(const ptmr_t& timer);
+		
+		/** @brief returns trace span name */
+		TraceName<> getSpanName() const { return TraceName<>( getName() ); }
+	};
+	
+	/** @brief times enclosing scope into the timer when enabled, and into a trace span when built with SPHINX_TRACE, empty when both are off */
+	template<bool Enabled = kInstrumentEnabled>
+	class InstrumentScope : private TraceSpan<>
+	{
+	  public:
+		
+		/** @brief constructor */
+		InstrumentScope(const InstrumentTimer<Enabled>& timer) : TraceSpan<>( timer.getSpanName() ) { /* no-op */ }
+	};
+	
+	template<>
+	class InstrumentScope<true> : private TraceSpan<>
+	{
+	  private:
+		
+		InstrumentTimer<true>&	mTimer;		//!< accumulating timer
+		ptmr_t					mPtmr;		//!< sphinxbase timer for this scope
+		
+	  public:
+		
+		/** @brief constructor, span encloses timer */
+		InstrumentScope(InstrumentTimer<true>& timer) : TraceSpan<>( timer.getSpanName() ), mTimer( timer )
+		{
+			ptmr_init( &mPtmr );
+			mPtmr.name = timer.getName();
+			ptmr_start( &mPtmr );
+		}
+		
+		/** @brief destructor */
+		~InstrumentScope()
+		{
+			ptmr_stop( &mPtmr );
+			mTimer.add( mPtmr );
+		}
+	};
+	
+	/** @brief running total, empty when disabled */
+	template<bool Enabled = kInstrumentEnabled>
+	class InstrumentCounter
+	{
+	  public:
+		
+		/** @brief constructor */
+		constexpr InstrumentCounter(const char*) { }
+		
+		/** @brief adds to total */
+		void add(int64_t) { /* no-op */ }
+	};
+	
+	template<>
+	class InstrumentCounter<true> : public Instrument
+	{
+	  private:
+		
+		std::atomic<uint64_t>	mCount;		//!< additions
+		std::atomic<int64_t>	mValue;		//!< total
+		
+		void sample(Sample* output) const;
+		void clear();
+		
+	  public:
+		
+		/** @brief constructor */
+		InstrumentCounter(const char* name) : Instrument( name, Kind::Counter ), mCount( 0 ), mValue( 0 ) { /* no-op */ }
+		
+		/** @brief adds to total */
+		void add(int64_t value)
+		{
+			mCount.fetch_add( 1, std::memory_order_relaxed );
+			mValue.fetch_add( value, std::memory_order_relaxed );
+		}
+	};
+	
+	/** @brief last and maximum value, also emitted as a trace counter, empty when disabled */
+	template<bool Enabled = kInstrumentEnabled>
+	class InstrumentGauge
+	{
+	  public:
+		
+		/** @brief constructor */
+		constexpr InstrumentGauge(const char*) { }
+		
+		/** @brief sets value */
+		void set(int64_t) { /* no-op */ }
+	};
+	
+	template<>
+	class InstrumentGauge<true> : public Instrument
+	{
+	  private:
+		
+		std::atomic<uint64_t>	mCount;		//!< updates
+		std::atomic<int64_t>	mValue;		//!< last value
+		std::atomic<int64_t>	mMax;		//!< maximum value
+		
+		void sample(Sample* output) const;
+		void clear();
+		
+	  public:
+		
+		/** @brief constructor */
+		InstrumentGauge(const char* name) : Instrument( name, Kind::Gauge ), mCount( 0 ), mValue( 0 ), mMax( 0 ) { /* no-op */ }
+		
+		/** @brief sets value */
+		void set(int64_t value);
+	};
+	
+} // namespace sphinx
+
+#define SPHINX_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define SPHINX_INSTRUMENT_CONCAT(a, b) SPHINX_INSTRUMENT_CONCAT_IMPL( a, b )
+
+//! times the rest of the enclosing scope into an InstrumentTimer
+#define SPHINX_TIMED_SCOPE(timer) ::sphinx::InstrumentScope<> SPHINX_INSTRUMENT_CONCAT( sphinxTimedScope, __LINE__ )( timer )
+
+//! adds to an InstrumentCounter and sets an InstrumentGauge, arguments are not evaluated when disabled
+#if defined( SPHINX_INSTRUMENT )
+#define SPHINX_COUNT(counter, value) (counter).add( value )
+#define SPHINX_GAUGE(gauge, value) (gauge).set( value )
+#else
+#define SPHINX_COUNT(counter, value) ((void)sizeof( (counter).add( value ), 0 ))
+#define SPHINX_GAUGE(gauge, value) ((void)sizeof( (gauge).set( value ), 0 ))
+#endif
@@ -0,0 +1,76 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+
+namespace sphinx {
+	
+	/** @brief microbenchmark of instrumentation cost on a decoder-sized block kernel, comparing uninstrumented, disabled and enabled instruments in one build */
+	class InstrumentBenchmark
+	{
+	  public:
+		
+		/** @brief measurements for one variant */
+		struct Result
+		{
+			std::string		variant;			//!< "bare", "disabled", "enabled" or "enabled-tracing"
+			size_t			iterations;			//!< kernel calls per measurement
+			double			nsPerIteration;		//!< best nanoseconds per kernel call
+			double			overheadNs;			//!< nanoseconds per call above the bare kernel
+			size_t			instrumentBytes;	//!< storage of one timer, counter and gauge
+		};
+		
+	  private:
+		
+		size_t		mBlockSize;		//!< samples per kernel call
+		size_t		mIterations;	//!< kernel calls per measurement
+		size_t		mRepeats;		//!< measurements per variant, best is kept
+		
+	  public:
+		
+		/** @brief constructor */
+		InstrumentBenchmark();
+		
+		/** @brief sets samples per kernel call, defaults to 160 (10 ms at 16 kHz) */
+		InstrumentBenchmark& blockSize(size_t size) { mBlockSize = size > 0 ? size : 1; return *this; }
+		
+		/** @brief sets kernel calls per measurement, defaults to 200000 */
+		InstrumentBenchmark& iterations(size_t count) { mIterations = count > 0 ? count : 1; return *this; }
+		
+		/** @brief sets measurements per variant, defaults to 5 */
+		InstrumentBenchmark& repeats(size_t count) { mRepeats = count > 0 ? count : 1; return *this; }
+		
+		/** @brief measures every variant, tracing variant writes to tracePath when not empty and records spans only when built with SPHINX_TRACE */
+		std::vector<Result> run(const ci::fs::path& tracePath = ci::fs::path()) const;
+		
+		/** @brief writes results as CSV */
+		static void writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,137 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <functional>
+
+#include "sphinx/RecognizerConfig.hpp"
+
+namespace sphinx {
+	
+	/** @brief tightens search pruning while decoding falls behind real time and relaxes it again when idle */
+	class LoadShedder
+	{
+	  public:
+		
+		/** @brief pruning applied on top of base configuration at one shedding level, non-positive fields keep base value */
+		struct Level
+		{
+			double	beam;
+			double	wbeam;
+			int		maxhmmpf;
+			int		ds;			//!< Gaussian downsampling, which reloads the acoustic model on the decode thread and needs allowReinit
+		};
+		
+		/** @brief load shedding parameters */
+		class Format
+		{
+		  private:
+			
+			double				mUpperLoad;		//!< smoothed load above which pruning is tightened
+			double				mLowerLoad;		//!< smoothed load below which pruning is relaxed
+			double				mSmoothing;		//!< per-block exponential smoothing factor
+			double				mCooldown;		//!< audio seconds between level changes
+			std::vector<Level>	mLevels;		//!< tightening steps, excluding base level
+			bool				mAllowReinit;	//!< levels may change -ds flag
+			
+		  public:
+			
+			/** @brief default constructor */
+			Format();
+			
+			/** @brief sets processing time per audio time above which pruning is tightened */
+			Format& upperLoad(double value) { mUpperLoad = value; return *this; }
+			/** @brief sets processing time per audio time below which pruning is relaxed */
+			Format& lowerLoad(double value) { mLowerLoad = value; return *this; }
+			/** @brief sets exponential smoothing factor applied per block, in (0,1] */
+			Format& smoothing(double value) { mSmoothing = value; return *this; }
+			/** @brief sets minimum audio seconds between level changes */
+			Format& cooldown(double seconds) { mCooldown = seconds; return *this; }
+			/** @brief sets tightening steps, progressively cheaper */
+			Format& levels(const std::vector<Level>& value) { mLevels = value; return *this; }
+			/** @brief permits levels that change -ds, each such change reinitializing the decoder while it is already behind, defaults to false */
+			Format& allowReinit(bool value) { mAllowReinit = value; return *this; }
+			
+			double getUpperLoad() const { return mUpperLoad; }
+			double getLowerLoad() const { return mLowerLoad; }
+			double getSmoothing() const { return mSmoothing; }
+			double getCooldown() const { return mCooldown; }
+			const std::vector<Level>& getLevels() const { return mLevels; }
+			bool getAllowReinit() const { return mAllowReinit; }
+		};
+		
+		/** @brief snapshot of shedding state */
+		struct Metrics
+		{
+			size_t		level;			//!< current level, 0 is base configuration
+			double		load;			//!< smoothed processing time per audio time
+			uint64_t	tightened;		//!< number of tightening adjustments
+			uint64_t	relaxed;		//!< number of relaxing adjustments
+			uint64_t	failed;			//!< level changes that could not be applied
+		};
+		
+		typedef std::function<void(size_t fromLevel, size_t toLevel, double load)> AdjustFn;
+		
+	  private:
+		
+		Format					mFormat;		//!< parameters
+		AdjustFn				mAdjustCb;		//!< adjustment callback
+		double					mSinceChange;	//!< audio seconds since last level change
+		std::atomic<size_t>		mLevel;			//!< current level
+		std::atomic<double>		mLoad;			//!< smoothed load
+		std::atomic<uint64_t>	mTightened;		//!< tightening count
+		std::atomic<uint64_t>	mRelaxed;		//!< relaxing count
+		std::atomic<uint64_t>	mFailed;		//!< failed change count
+		
+	  public:
+		
+		/** @brief constructor, throws if format is inconsistent */
+		LoadShedder(const Format& format, const AdjustFn& adjustCb = nullptr);
+		
+		/** @brief records time spent decoding a block of audio */
+		void update(double processSeconds, double audioSeconds);
+		
+		/** @brief returns true if level should change, called between utterances */
+		bool poll(size_t* targetLevel) const;
+		
+		/** @brief records completed level change */
+		void commit(size_t level);
+		
+		/** @brief records level change that could not be applied, retried after cooldown */
+		void reject();
+		
+		/** @brief returns base configuration with pruning of given level applied */
+		RecognizerConfig configure(const RecognizerConfig& base, size_t level) const;
+		
+		/** @brief returns base configuration with given pruning applied, non-positive fields keep base value */
+		static RecognizerConfig apply(const RecognizerConfig& base, const Level& level);
+		
+		/** @brief returns snapshot of shedding state, safe to call from any thread */
+		Metrics getMetrics() const;
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,84 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <sphinxbase/fsg_model.h>
+
+#include "cinder/Filesystem.h"
+
+namespace sphinx {
+	
+	/** @brief memory held by one recognizer, its models and buffers, plus process-wide totals for sizing pools and eviction budgets */
+	struct MemoryReport
+	{
+		/** @brief finite-state grammar added with addModelJsgf */
+		struct Grammar
+		{
+			std::string		key;			//!< model key
+			size_t			states;			//!< FSG states
+			size_t			transitions;	//!< FSG transitions, including null transitions
+			size_t			words;			//!< FSG vocabulary
+			size_t			bytes;			//!< estimated heap bytes
+		};
+		
+		std::vector<Grammar>	grammars;				//!< added grammars
+		size_t					grammarBytes;			//!< estimated heap bytes across grammars
+		size_t					acousticModelBytes;		//!< acoustic model file bytes, an upper bound on what the decoder loads
+		bool					acousticModelMapped;	//!< acoustic model mapped (-mmap) rather than read into private memory
+		size_t					dictionaryEntries;		//!< source dictionary entries, when vocabulary is pruned
+		size_t					dictionaryBytes;		//!< source dictionary image bytes
+		bool					dictionaryMapped;		//!< dictionary image mapped from a binary cache
+		size_t					latticeNodes;			//!< last utterance lattice nodes, when lattices are tracked
+		size_t					latticeLinks;			//!< last utterance lattice links, when lattices are tracked
+		size_t					rawDataBytes;			//!< raw audio retained by the decoder at the last utterance end
+		size_t					bufferBytes;			//!< wrapper-owned audio buffers
+		size_t					decoders;				//!< live decoders in process
+		size_t					processMappedBytes;		//!< resident file-backed bytes in process (Linux only)
+		size_t					processPrivateBytes;	//!< resident private dirty bytes in process (Linux only)
+		
+		/** @brief constructor */
+		MemoryReport();
+		
+		/** @brief returns bytes of this recognizer backed by mapped files */
+		size_t getMappedBytes() const;
+		
+		/** @brief returns bytes of this recognizer in private memory */
+		size_t getPrivateBytes() const;
+		
+		/** @brief measures grammar, walking every transition */
+		static Grammar measureGrammar(const std::string& key, fsg_model_t* model);
+		
+		/** @brief returns bytes of regular files in directory, not recursive */
+		static size_t measureDirectory(const ci::fs::path& dirPath);
+		
+		/** @brief reads process resident file-backed and private dirty bytes, returns false and leaves both zero where unsupported or unreadable */
+		static bool measureProcess(size_t* mappedBytes, size_t* privateBytes);
+	};
+	
+} // namespace sphinx
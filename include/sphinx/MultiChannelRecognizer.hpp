@@ -0,0 +1,123 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include "sphinx/Recognizer.hpp"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class MultiChannelRecognizer> MultiChannelRecognizerRef;
+	
+	/** @brief decodes each input channel independently, with one recognizer per channel driven by a shared worker pool */
+	class MultiChannelRecognizer
+	{
+	  private:
+		
+		std::vector<RecognizerRef>			mChannels;		//!< per-channel recognizers
+		std::vector<ResamplerRef>			mResamplers;	//!< per-channel resamplers
+		std::vector<std::vector<int16_t> >	mData;			//!< per-channel decoder input
+		std::vector<std::vector<float> >	mScratch;		//!< per-channel float input for resampling int16 sources
+		
+		AudioSourceRef						mSource;		//!< multi-channel audio source
+		AudioSource::Block					mBlock;			//!< block being decoded
+		
+		size_t								mNumThreads;	//!< worker count
+		std::vector<std::thread>			mWorkers;		//!< decode workers
+		std::thread							mReader;		//!< source reader thread
+		std::atomic<bool>					mStop;			//!< runner flag
+		std::mutex							mMutex;			//!< guards block hand-off
+		std::condition_variable				mWorkCv;		//!< signals new block to workers
+		std::condition_variable				mDoneCv;		//!< signals block completion to reader
+		uint64_t							mGeneration;	//!< block sequence number
+		size_t								mPending;		//!< channels of current block not yet decoded
+		std::atomic<size_t>					mNextChannel;	//!< next channel of current block to claim
+		
+		ci::audio::InputDeviceNodeRef		mInputNode;		//!< audio input node
+		CaptureNodeRef						mCaptureNode;	//!< audio capture node
+		
+		ThreadPolicy						mThreadPolicy;	//!< reader and worker thread policy
+		mutable std::mutex					mPolicyMutex;	//!< guards policy results
+		std::vector<ThreadPolicy::Result>	mPolicyResults;	//!< policy in effect per thread, reader first
+		
+		MultiChannelRecognizer(MultiChannelRecognizer const&) = delete;
+		MultiChannelRecognizer& operator=(MultiChannelRecognizer const&) = delete;
+		
+		/** @brief private constructor */
+		MultiChannelRecognizer(size_t numThreads);
+		
+		/** @brief private reader method */
+		void read();
+		
+		/** @brief private worker method */
+		void work(size_t index);
+		
+		/** @brief converts and decodes one channel of current block */
+		void decodeChannel(size_t channel);
+		
+	  public:
+		
+		/** @brief static creational method, loads one decoder per channel on background threads (ps_init itself runs one at a time); thread count defaults to the lesser of channel count and hardware concurrency */
+		static MultiChannelRecognizerRef create(const RecognizerConfig& settings, size_t numChannels, size_t numThreads = 0);
+		
+		/** @brief destructor */
+		~MultiChannelRecognizer();
+		
+		/** @brief returns channel count */
+		size_t getNumChannels() const { return mChannels.size(); }
+		
+		/** @brief returns recognizer decoding channel, for per-channel handlers, models and stats */
+		RecognizerRef getChannel(size_t channel) const { return mChannels.at( channel ); }
+		
+		/** @brief connects basic event handler tagged with channel index to every channel, called concurrently from worker threads */
+		void connectEventHandler(const std::function<void(size_t, const std::string&)>& eventCb);
+		
+		/** @brief adds model from JSGF filepath to every channel and associates it with key, optionally sets model active */
+		void addModelJsgf(const std::string& key, const ci::fs::path& jsgfPath, bool setActive = true);
+		
+		/** @brief adds model from JSGF string to every channel and associates it with key, optionally sets model active */
+		void addModelJsgf(const std::string& key, const std::string& jsgfData, bool setActive = true);
+		
+		/** @brief sets active model from key on every channel, throws if key is unfound */
+		void setActiveModel(const std::string& key);
+		
+		/** @brief sets reader and worker thread policy, worker names are suffixed with their index, must be called before start */
+		void setThreadPolicy(const ThreadPolicy& policy) { mThreadPolicy = policy; }
+		
+		/** @brief returns policy in effect for reader then each worker, once started */
+		std::vector<ThreadPolicy::Result> getThreadPolicyResults() const;
+		
+		/** @brief starts recognizer on default input device opened with one channel per recognizer */
+		void start();
+		
+		/** @brief starts recognizer on audio source, whose channel count must match */
+		void start(const AudioSourceRef& source);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,79 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace sphinx {
+	
+	/** @brief fixed-capacity ring of the most recent audio withheld by the energy gate, replayed when the gate opens so onsets are not clipped */
+	class PreRoll
+	{
+	  private:
+		
+		std::vector<int16_t>	mData;		//!< ring storage, allocated once
+		size_t					mPos;		//!< write position
+		size_t					mSize;		//!< samples held
+		
+	  public:
+		
+		/** @brief constructor, allocates capacity samples */
+		PreRoll(size_t capacity = 0) : mData( capacity ), mPos( 0 ), mSize( 0 ) { /* no-op */ }
+		
+		/** @brief reallocates storage and empties ring, not for use on decode thread */
+		void setCapacity(size_t capacity) { mData.assign( capacity, 0 ); clear(); }
+		
+		/** @brief returns capacity in samples */
+		size_t getCapacity() const { return mData.size(); }
+		
+		/** @brief returns samples held */
+		size_t size() const { return mSize; }
+		
+		/** @brief empties ring */
+		void clear() { mPos = 0; mSize = 0; }
+		
+		/** @brief appends block, overwriting oldest samples */
+		void push(const int16_t* data, size_t size);
+		
+		/** @brief passes held samples in time order to fn as at most two contiguous segments, then empties ring */
+		template<typename Fn>
+		void replay(Fn fn)
+		{
+			if( mSize == 0 )
+				return;
+			const size_t capacity = mData.size();
+			size_t begin = ( mPos + capacity - mSize ) % capacity;
+			size_t first = std::min( mSize, capacity - begin );
+			size_t second = mSize - first;
+			clear();
+			fn( mData.data() + begin, first );
+			if( second > 0 )
+				fn( mData.data(), second );
+		}
+	};
+	
+} // namespace sphinx
@@ -29,14 +29,39 @@
 #include <cassert>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <future>
+#include <mutex>
+#include <unordered_set>
 
 #include <pocketsphinx.h>
 
 #include <sphinxbase/jsgf.h>
 #include <sphinxbase/fsg_model.h>
+#include <sphinxbase/feat.h>
+#include <sphinxbase/err.h>
 
 #include "cinder/Filesystem.h"
 
+#include "sphinx/AudioConvert.hpp"
+#include "sphinx/AudioSource.hpp"
+#include "sphinx/CaptureQueue.hpp"
+#include "sphinx/Dictionary.hpp"
+#include "sphinx/RecognizerConfig.hpp"
+#include "sphinx/LoadShedder.hpp"
+#include "sphinx/Endpointer.hpp"
+#include "sphinx/EnergyGate.hpp"
+#include "sphinx/Instrument.hpp"
+#include "sphinx/MemoryReport.hpp"
+#include "sphinx/PreRoll.hpp"
+#include "sphinx/Resampler.hpp"
+#include "sphinx/ResultSink.hpp"
+#include "sphinx/ResultRing.hpp"
+#include "sphinx/SessionLog.hpp"
+#include "sphinx/Stats.hpp"
+#include "sphinx/Trace.hpp"
+
 #include "cinder/audio/Context.h"
 #include "cinder/audio/MonitorNode.h"
 #include "cinder/audio/dsp/Converter.h"
@@ -71,7 +96,8 @@ namespace sphinx {
 	
 	  private:
 		
-		CallbackFn mCb;
+		CallbackFn	mCb;
+		std::string	mMessage;	//!< hypothesis, reused across utterances
 		
 	  public:
 		
@@ -91,7 +117,9 @@ namespace sphinx {
 		
 	  private:
 		
-		CallbackFn mCb;
+		CallbackFn					mCb;
+		std::vector<std::string>	mSegments;	//!< words, reused across utterances
+		std::vector<std::string>	mSpare;		//!< surplus words kept for their capacity
 		
 	  public:
 		
@@ -111,7 +139,9 @@ namespace sphinx {
 		
 	  private:
 		
-		CallbackFn mCb;
+		CallbackFn									mCb;
+		std::vector<std::pair<std::string,float> >	mSegments;	//!< words and confidences, reused across utterances
+		std::vector<std::pair<std::string,float> >	mSpare;		//!< surplus words kept for their capacity
 		
 	  public:
 		
@@ -148,6 +178,9 @@ namespace sphinx {
 		
 		/** @brief destructor */
 		~ModelFsg() { fsg_model_free( mModel ); }
+		
+		/** @brief returns FSG model */
+		fsg_model_t* getModel() const { return mModel; }
 	};
 	
 	/** @brief speech recognizer */
@@ -159,12 +192,60 @@ namespace sphinx {
 		std::atomic<bool>					mStop;			//!< runner flag
 		std::thread							mThread;		//!< runner thread
 		
+		std::atomic<bool>					mReady;			//!< decoder ready flag
+		std::atomic<bool>					mFailed;		//!< decoder initialization failure flag
+		std::thread							mInitThread;	//!< background initialization thread
+		std::mutex							mInitMutex;		//!< guards deferred model operations
+		std::vector<std::function<void()> >	mDeferred;		//!< model operations deferred until ready
+		std::promise<void>					mReadyPromise;	//!< readiness promise
+		std::shared_future<void>			mReadyFuture;	//!< readiness future
+		std::vector<int16_t>				mEarlyAudio;	//!< audio captured before ready
+		Endpointer							mEndpointer;	//!< utterance segmentation
+		
+		std::mutex							mAdaptMutex;	//!< guards adaptation state
+		std::vector<mfcc_t>					mCmnMean;		//!< cepstral mean snapshot
+		float								mAgcEmax;		//!< AGC energy maximum snapshot
+		std::atomic<bool>					mAdaptPending;	//!< adaptation state awaiting application flag
+		
+		std::unique_ptr<LoadShedder>		mLoadShedder;	//!< adaptive pruning controller, if enabled
+		std::unique_ptr<EnergyGate>			mGate;			//!< pre-decoder energy gate, if enabled
+		PreRoll								mPreRoll;		//!< most recent audio withheld by energy gate
+		bool								mReplayPending;	//!< pre-roll replay before next block flag, set when gate opens
+		Stats								mStats;			//!< decode counters and histograms
+		bool								mDecoding;		//!< utterance started flag
+		std::vector<float>					mAnalysis;		//!< float copy of externally decoded audio for energy gate
+		std::atomic<bool>					mTrackLattices;	//!< lattice measurement at utterance end flag
+		std::atomic<size_t>					mLatticeNodes;	//!< last utterance lattice nodes
+		std::atomic<size_t>					mLatticeLinks;	//!< last utterance lattice links
+		std::atomic<size_t>					mRawDataBytes;	//!< decoder raw audio at last utterance end
+		std::atomic<size_t>					mBufferBytes;	//!< wrapper audio buffers at last utterance end
+		
+		RecognizerConfig					mSettings;		//!< recognizer settings
 		cmd_ln_t*							mConfig;		//!< pocketsphinx config
 		ps_decoder_t*						mDecoder;		//!< pocketsphinx decoder
 		std::map<std::string,ModelRef>		mModelMap;		//!< language model map
+		DictionaryRef						mDictionary;	//!< source dictionary for pruned vocabulary, if enabled
+		std::unordered_set<std::string>		mVocabulary;	//!< model words loaded from a text source dictionary
 		
 		ci::audio::InputDeviceNodeRef		mInputNode;		//!< audio input node
-		ci::audio::MonitorNodeRef			mMonitorNode;	//!< audio monitor node
+		CaptureNodeRef						mCaptureNode;	//!< audio capture node
+		CaptureQueue::Overflow				mCaptureOverflow;	//!< device capture queue overflow policy
+		size_t								mCaptureMs;		//!< device capture queue depth
+		AudioSourceRef						mSource;		//!< audio read by runner thread
+		ThreadPolicy						mThreadPolicy;	//!< runner thread policy
+		SessionRecorderRef					mRecorder;		//!< decoder input log, if recording, used by decoding thread only
+		std::mutex							mRecorderMutex;	//!< guards pending recorder
+		SessionRecorderRef					mPendingRecorder;	//!< recorder replacing mRecorder at next block
+		std::atomic<bool>					mRecorderPending;	//!< recorder swap awaiting application flag
+		ResultSinkRef						mResultSink;	//!< structured result output, if set
+		ResultRingRef						mResultRing;	//!< shared-memory result output, if set
+		size_t								mPartialSamples;	//!< samples between partial results, 0 for finals only
+		size_t								mSincePartial;	//!< samples since last partial result
+		uint64_t							mUttStarted;	//!< utterances started
+		uint64_t							mUttIndex;		//!< index of utterance in progress, shared by result sink and ring
+		bool								mUttPartials;	//!< partial published for utterance in progress flag
+		size_t								mUttDropped;	//!< samples lost during current utterance
+		uint32_t							mTraceSession;	//!< trace session id
 						
 		Recognizer(Recognizer const&) = delete;
 		Recognizer& operator=(Recognizer const&) = delete;
@@ -173,20 +254,85 @@ namespace sphinx {
 		Recognizer();
 		
 		/** @brief private initialization method */
-		void initialize(const ci::fs::path& hmmPath, const ci::fs::path& dictPath);
+		void initialize(const RecognizerConfig& settings);
+		
+		/** @brief private background initialization method, reports failure through readiness future */
+		void initializeAsync(const RecognizerConfig& settings, const std::function<void()>& readyCb);
+		
+		/** @brief runs operation immediately if ready, otherwise defers it until ready */
+		void whenReady(const std::function<void()>& op);
+		
+		/** @brief adds model from JSGF string to decoder */
+		void addModelJsgfImpl(const std::string& key, const std::string& jsgfData, bool setActive);
+		
+		/** @brief adds pronunciations for model words missing from the pruned decoder dictionary */
+		void addModelWords(fsg_model_t* model);
 		
 		/** @brief private runner method */
 		void run();
 		
+		/** @brief decodes 16 kHz mono block through gate, pre-roll and endpointer, analysis is its float equivalent when gated */
+		void decodeBlock(const int16_t* data, size_t size, const float* analysis);
+		
+		/** @brief runs energy gate on block, scheduling pre-roll replay on opening, returns true if block should be decoded */
+		bool gate(const float* analysis, const int16_t* data, size_t size);
+		
+		/** @brief feeds converted audio to decoder and dispatches utterances to handler */
+		void process(const int16_t* data, size_t size);
+		
+		/** @brief finishes utterance, records its timings and passes it to handler */
+		void endUtterance(bool cut);
+		
+		/** @brief finishes utterance without passing it to handler */
+		void endUtteranceSilently();
+		
+		/** @brief starts utterance, applying pending adaptation state first */
+		void startUtterance();
+		
+		/** @brief snapshots decoder CMN/AGC state, called between utterances */
+		void captureAdaptationState();
+		
+		/** @brief swaps in recorder set by startRecording or stopRecording, called on decoding thread */
+		void applyRecorder();
+		
+		/** @brief counts nodes and links of the finished utterance's lattice */
+		void measureLattice();
+		
+		/** @brief records decoder raw audio and wrapper buffer sizes for memoryReport, called on decoding thread */
+		void measureBuffers();
+		
+		/** @brief applies load shedding level's settings by re-registering models with their pruning, reinitializing decoder only if -ds changes, called between utterances; a failed reinitialization keeps the current level, returns false only if the decoder could not be restored */
+		bool reconfigure(size_t level, const RecognizerConfig& settings);
+		
 	  public:
 		
 		/** @brief static creational method */
-		static RecognizerRef create(const ci::fs::path& hmmPath, const ci::fs::path& dictPath)
+		static RecognizerRef create(const RecognizerConfig& settings)
+		{
+			RecognizerRef r = RecognizerRef( new Recognizer() );
+			r->initialize( settings );
+			return r;
+		}
+		
+		/** @brief static creational method, optionally limits decoder dictionary to words used by added models (always the case for binary dictionary caches) */
+		static RecognizerRef create(const ci::fs::path& hmmPath, const ci::fs::path& dictPath, bool pruneDict = false)
+		{
+			return create( RecognizerConfig( hmmPath, dictPath ).pruneDict( pruneDict ) );
+		}
+		
+		/** @brief static creational method, returns immediately and loads decoder on a background thread; optional callback is called from that thread once ready */
+		static RecognizerRef createAsync(const RecognizerConfig& settings, const std::function<void()>& readyCb = nullptr)
 		{
 			RecognizerRef r = RecognizerRef( new Recognizer() );
-			r->initialize( hmmPath, dictPath );
+			r->mInitThread = std::thread( &Recognizer::initializeAsync, r.get(), settings, readyCb );
 			return r;
 		}
+		
+		/** @brief static creational method, returns immediately and loads decoder on a background thread; optional callback is called from that thread once ready */
+		static RecognizerRef createAsync(const ci::fs::path& hmmPath, const ci::fs::path& dictPath, bool pruneDict = false, const std::function<void()>& readyCb = nullptr)
+		{
+			return createAsync( RecognizerConfig( hmmPath, dictPath ).pruneDict( pruneDict ), readyCb );
+		}
 
 		/** @brief destructor */
 		~Recognizer();
@@ -203,17 +349,101 @@ namespace sphinx {
 		/** @brief connects word segmentation confidence event handler to recognizer */
 		void connectEventHandler(const std::function<void(const std::vector<std::pair<std::string,float> >&)>& eventCb);
 		
-		/** @brief adds model from JSGF filepath and associates it with key, optionally sets model active */
+		/** @brief streams every delivered utterance to sink in addition to the event handler, must be set before start */
+		void setResultSink(const ResultSinkRef& sink) { mResultSink = sink; }
+		
+		/** @brief publishes final results to shared-memory ring, plus partial hypotheses every partialMs of audio if nonzero, must be set before start */
+		void setResultRing(const ResultRingRef& ring, size_t partialMs = 0) { mResultRing = ring; mPartialSamples = partialMs * 16; }
+		
+		/** @brief returns pocketsphinx decoder for direct use while recognizer is not running, or NULL if not ready */
+		ps_decoder_t* getDecoder() const { return mReady ? mDecoder : NULL; }
+		
+		/** @brief returns true once decoder is initialized */
+		bool isReady() const { return mReady; }
+		
+		/** @brief returns future that becomes ready with decoder, or holds initialization exception */
+		std::shared_future<void> getReadyFuture() const { return mReadyFuture; }
+		
+		/** @brief adds model from JSGF filepath and associates it with key, optionally sets model active (deferred until ready) */
 		void addModelJsgf(const std::string& key, const ci::fs::path& jsgfPath, bool setActive = true);
 		
-		/** @brief adds model from JSGF string and associates it with key, optionally sets model active */
+		/** @brief adds model from JSGF string and associates it with key, optionally sets model active (deferred until ready) */
 		void addModelJsgf(const std::string& key, const std::string& jsgfData, bool setActive = true);
 		
-		/** @brief sets active model from key, throws if key is unfound */
+		/** @brief looks up pronunciation in source dictionary without allocating, returns false if unfound, not ready or dictionary is not pruned */
+		bool lookupWord(const std::string& word, Pronunciation* output) const;
+		
+		/** @brief sets active model from key (deferred until ready), throws if key is unfound */
 		void setActiveModel(const std::string& key);
 		
-		/** @brief starts recognizer */
+		/** @brief writes warm CMN/AGC state from the most recent utterance to file, throws if none is available */
+		void saveAdaptationState(const ci::fs::path& statePath);
+		
+		/** @brief reads CMN/AGC state from file and applies it to decoder before the next utterance */
+		void loadAdaptationState(const ci::fs::path& statePath);
+		
+		/** @brief sets utterance segmentation parameters, must be called before start */
+		void setEndpointerFormat(const Endpointer::Format& format);
+		
+		/** @brief sets duration of recent audio withheld by the energy gate that is replayed to the decoder when the gate opens, zero disables, must be called before start */
+		void setPreRoll(size_t ms);
+		
+		/** @brief enables energy gate ahead of decoder so silent audio is not decoded, must be called before start */
+		void enableEnergyGate(const EnergyGate::Format& format = EnergyGate::Format());
+		
+		/** @brief returns energy gate state, or zeroed metrics if disabled */
+		EnergyGate::Metrics getEnergyGateMetrics() const;
+		
+		/** @brief enables adaptive load shedding with optional per-adjustment callback (called on decode thread), must be called before start */
+		void enableLoadShedding(const LoadShedder::Format& format = LoadShedder::Format(), const LoadShedder::AdjustFn& adjustCb = nullptr);
+		
+		/** @brief returns load shedding state, or zeroed metrics if disabled */
+		LoadShedder::Metrics getLoadSheddingMetrics() const;
+		
+		/** @brief returns snapshot of decode counters and per-utterance timing histograms, safe to call from any thread */
+		Stats::Snapshot getStats() const { return mStats.snapshot(); }
+		
+		/** @brief returns memory held by models, decoder and buffers, with decoding-thread figures as of the last utterance end */
+		MemoryReport memoryReport() const;
+		
+		/** @brief enables building and measuring each utterance's lattice for memoryReport, which costs decode time */
+		void trackLattices(bool enable) { mTrackLattices = enable; }
+		
+		/** @brief decodes 16 kHz mono block on calling thread, for recognizers driven externally rather than started, throws if not ready */
+		void decode(const int16_t* data, size_t size);
+		
+		/** @brief delivers utterance in progress to handler, for recognizers driven externally */
+		void finish();
+		
+		/** @brief drops utterance in progress without delivering it and starts afresh, for recognizers driven externally */
+		void discard();
+		
+		/** @brief records 16 kHz samples lost before decoding in stats and current utterance, for recognizers driven externally */
+		void markDropped(size_t blocks, size_t samples);
+		
+		/** @brief returns 16 kHz samples lost before decoding during utterance being delivered, valid within handler */
+		size_t getUtteranceDroppedSamples() const { return mUttDropped; }
+		
+		/** @brief sets device capture queue depth and overflow policy (Block is not permitted on the audio thread), must be called before start */
+		void setCaptureOverflow(CaptureQueue::Overflow policy, size_t capacityMs = 1000);
+		
+		/** @brief starts logging decoder input, utterance boundaries, search changes and load shedding to file, from the runner thread's next block once started, otherwise immediately and must be called between decode calls */
+		void startRecording(const ci::fs::path& logPath);
+		
+		/** @brief stops logging, the log is flushed and closed by the runner thread at its next block once started, otherwise immediately */
+		void stopRecording();
+		
+		/** @brief feeds recorded session to decoder on calling thread with its original boundaries and pruning, paced at original timing or as fast as possible, throws if recognizer is running; models must be added first */
+		void replay(const ci::fs::path& logPath, bool paced = false);
+		
+		/** @brief sets runner thread scheduling, priority, affinity and name, applied when it starts and reported in stats, must be called before start */
+		void setThreadPolicy(const ThreadPolicy& policy) { mThreadPolicy = policy; }
+		
+		/** @brief starts recognizer on default input device, audio captured before ready is decoded once ready */
 		void start();
+		
+		/** @brief starts recognizer on audio source, 16 kHz mono int16 sources are decoded from the source's buffers without conversion or copying */
+		void start(const AudioSourceRef& source);
 	};
 	
 } // namespace sphinx
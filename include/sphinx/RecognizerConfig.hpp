@@ -0,0 +1,135 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <stdexcept>
+
+#include <pocketsphinx.h>
+
+#include "cinder/Filesystem.h"
+
+namespace sphinx {
+	
+	/** @brief named search pruning presets */
+	enum class Preset
+	{
+		LowLatency,		//!< no phoneme lookahead and moderate pruning, result follows speech end closely
+		LowCpu,			//!< narrow beams, GMM downsampling and few Gaussians, for many streams per core
+		HighAccuracy	//!< wide beams and more Gaussians, for offline or single-stream use
+	};
+	
+	/** @brief typed recognizer configuration, passed through to pocketsphinx as command-line arguments */
+	class RecognizerConfig
+	{
+	  private:
+		
+		ci::fs::path						mHmmPath;		//!< acoustic model directory
+		ci::fs::path						mDictPath;		//!< dictionary or dictionary cache path
+		bool								mPruneDict;		//!< pruned dictionary flag
+		std::map<std::string,std::string>	mArgs;			//!< explicitly set decoder arguments
+		
+		/** @brief stores argument value */
+		RecognizerConfig& setArg(const std::string& name, const std::string& value) { mArgs[ name ] = value; return *this; }
+		
+		/** @brief throws if condition is unmet */
+		static void require(bool condition, const std::string& message) { if( ! condition ) throw std::runtime_error( "Invalid recognizer config: " + message ); }
+		
+		/** @brief formats floating point argument without loss of precision */
+		static std::string toArg(double value);
+		
+		/** @brief formats boolean argument */
+		static std::string toArg(bool value) { return value ? "yes" : "no"; }
+		
+	  public:
+		
+		/** @brief default constructor */
+		RecognizerConfig() : mPruneDict( false ) { setArg( "-logfn", "/dev/null" ); }
+		
+		/** @brief constructor */
+		RecognizerConfig(const ci::fs::path& hmmPath, const ci::fs::path& dictPath) : RecognizerConfig() { hmm( hmmPath ); dict( dictPath ); }
+		
+		/** @brief sets acoustic model directory */
+		RecognizerConfig& hmm(const ci::fs::path& path) { mHmmPath = path; return *this; }
+		/** @brief sets dictionary text file or binary dictionary cache */
+		RecognizerConfig& dict(const ci::fs::path& path) { mDictPath = path; return *this; }
+		/** @brief limits decoder dictionary to words used by added models */
+		RecognizerConfig& pruneDict(bool enable) { mPruneDict = enable; return *this; }
+		/** @brief sets decoder log file, defaults to /dev/null; pocketsphinx logs to one process-wide stream, so the most recently initialized recognizer's file applies to all */
+		RecognizerConfig& logFile(const ci::fs::path& path) { return setArg( "-logfn", path.string() ); }
+		
+		/** @brief sets Viterbi beam width (-beam), smaller values mean wider beam */
+		RecognizerConfig& beam(double value) { require( value > 0.0 && value < 1.0, "beam must be in (0,1)" ); return setArg( "-beam", toArg( value ) ); }
+		/** @brief sets word exit beam width (-wbeam) */
+		RecognizerConfig& wbeam(double value) { require( value > 0.0 && value < 1.0, "wbeam must be in (0,1)" ); return setArg( "-wbeam", toArg( value ) ); }
+		/** @brief sets maximum active HMMs per frame (-maxhmmpf), -1 disables pruning */
+		RecognizerConfig& maxhmmpf(int value) { require( value == -1 || value > 0, "maxhmmpf must be -1 or positive" ); return setArg( "-maxhmmpf", std::to_string( value ) ); }
+		/** @brief sets maximum distinct word exits per frame (-maxwpf), -1 disables pruning */
+		RecognizerConfig& maxwpf(int value) { require( value == -1 || value > 0, "maxwpf must be -1 or positive" ); return setArg( "-maxwpf", std::to_string( value ) ); }
+		/** @brief sets GMM computation downsampling ratio (-ds) */
+		RecognizerConfig& ds(int value) { require( value >= 1, "ds must be at least 1" ); return setArg( "-ds", std::to_string( value ) ); }
+		/** @brief sets number of top Gaussians used in scoring (-topn) */
+		RecognizerConfig& topn(int value) { require( value >= 1, "topn must be at least 1" ); return setArg( "-topn", std::to_string( value ) ); }
+		/** @brief sets phoneme lookahead window in frames (-pl_window), 0 disables lookahead */
+		RecognizerConfig& plWindow(int value) { require( value >= 0, "pl_window must be non-negative" ); return setArg( "-pl_window", std::to_string( value ) ); }
+		/** @brief enables flat-lexicon second pass (-fwdflat) */
+		RecognizerConfig& fwdflat(bool enable) { return setArg( "-fwdflat", toArg( enable ) ); }
+		/** @brief enables lattice bestpath third pass (-bestpath) */
+		RecognizerConfig& bestpath(bool enable) { return setArg( "-bestpath", toArg( enable ) ); }
+		/** @brief enables memory-mapped model files (-mmap) */
+		RecognizerConfig& mmap(bool enable) { return setArg( "-mmap", toArg( enable ) ); }
+		
+		/** @brief sets speech frames kept before silence to speech transition (-vad_prespeech) */
+		RecognizerConfig& vadPrespeech(int frames) { require( frames >= 0, "vad_prespeech must be non-negative" ); return setArg( "-vad_prespeech", std::to_string( frames ) ); }
+		/** @brief sets speech frames needed to trigger silence to speech transition (-vad_startspeech) */
+		RecognizerConfig& vadStartspeech(int frames) { require( frames >= 1, "vad_startspeech must be at least 1" ); return setArg( "-vad_startspeech", std::to_string( frames ) ); }
+		/** @brief sets silence frames kept after speech to silence transition (-vad_postspeech) */
+		RecognizerConfig& vadPostspeech(int frames) { require( frames >= 1, "vad_postspeech must be at least 1" ); return setArg( "-vad_postspeech", std::to_string( frames ) ); }
+		/** @brief sets noise/speech log-ratio threshold (-vad_threshold) */
+		RecognizerConfig& vadThreshold(double value) { require( value > 0.0, "vad_threshold must be positive" ); return setArg( "-vad_threshold", toArg( value ) ); }
+		
+		/** @brief applies named preset to -beam, -wbeam, -maxhmmpf, -ds, -topn and -pl_window, later setters override it */
+		RecognizerConfig& preset(Preset value);
+		
+		/** @brief sets any other pocketsphinx argument by name (e.g. "-pbeam"), validated when decoder is configured */
+		RecognizerConfig& set(const std::string& name, const std::string& value) { require( ! name.empty() && name[ 0 ] == '-', "argument names start with '-'" ); return setArg( name, value ); }
+		
+		/** @brief returns acoustic model directory */
+		const ci::fs::path& getHmm() const { return mHmmPath; }
+		/** @brief returns dictionary path */
+		const ci::fs::path& getDict() const { return mDictPath; }
+		/** @brief returns pruned dictionary flag */
+		bool getPruneDict() const { return mPruneDict; }
+		/** @brief returns decoder log file, empty if unset */
+		ci::fs::path getLogFile() const { auto findArg = mArgs.find( "-logfn" ); return findArg != mArgs.end() ? ci::fs::path( findArg->second ) : ci::fs::path(); }
+		/** @brief returns explicitly set decoder arguments */
+		const std::map<std::string,std::string>& getArgs() const { return mArgs; }
+		
+		/** @brief creates pocketsphinx configuration, omitting -dict if dictionary is pruned and always omitting -logfn, throws on invalid arguments */
+		cmd_ln_t* createCmdLn(bool withDict) const;
+	};
+	
+} // namespace sphinx
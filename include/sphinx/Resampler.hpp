@@ -0,0 +1,60 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "cinder/audio/Buffer.h"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class Resampler> ResamplerRef;
+	
+	/** @brief converts device audio to 16 kHz mono int16 decoder input */
+	class Resampler
+	{
+	  public:
+		
+		/** @brief virtual destructor */
+		virtual ~Resampler() { /* no-op */ }
+		
+		/** @brief converts block of non-interleaved float audio, writing decoder input and optionally its float equivalent, returns frames written */
+		virtual size_t process(const ci::audio::Buffer& input, int16_t* output, float* analysis = NULL) = 0;
+		
+		/** @brief converts block of a single channel, for resamplers created with one channel, returns frames written */
+		virtual size_t process(const float* input, size_t numFrames, int16_t* output, float* analysis = NULL) = 0;
+		
+		/** @brief returns most frames one block can produce, longer blocks are split into chunks and need proportionally more */
+		virtual size_t getMaxOutputFrames() const = 0;
+		
+		/** @brief returns true if resampler is a dedicated integer-ratio decimator rather than the generic converter */
+		virtual bool isPolyphase() const = 0;
+		
+		/** @brief creates polyphase decimator for 16, 32, 48 and 96 kHz sources, generic converter otherwise */
+		static ResamplerRef create(size_t sourceSampleRate, size_t numChannels, size_t maxFramesPerBlock);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,161 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <pocketsphinx.h>
+
+#include "sphinx/ResultSink.hpp"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class ResultRing>		ResultRingRef;
+	typedef std::shared_ptr<class ResultRingReader>	ResultRingReaderRef;
+	
+	/** @brief POSIX shared-memory ring of utterance results and partial hypotheses, written by one recognizer process and read by any number of local processes
+	 
+	 Each slot is guarded by a sequence number (odd while being written), so readers copy without locks and detect when the
+	 writer has lapped them. Publishing wakes futex waiters only when a reader is waiting, so neither side makes a syscall per
+	 message. Futex waits are Linux only, other platforms poll.
+	 */
+	class ResultRing
+	{
+	  public:
+		
+		/** @brief message kind */
+		enum class Kind : uint32_t
+		{
+			Partial		= 1,	//!< hypothesis so far, without segments
+			Final		= 2,	//!< delivered utterance, with segments and confidences
+			Discard		= 3		//!< utterance that published partials ended without a final, without hypothesis
+		};
+		
+		struct Header;
+		
+	  private:
+		
+		std::string		mName;		//!< shared memory object name
+		int				mFd;		//!< shared memory descriptor
+		Header*			mHeader;	//!< mapped header
+		char*			mSlots;		//!< mapped slots
+		size_t			mMapSize;	//!< mapping size
+		uint64_t		mNext;		//!< next message sequence number
+		
+		ResultRing(const std::string& name, size_t numSlots, size_t slotBytes);
+		
+		ResultRing(ResultRing const&) = delete;
+		ResultRing& operator=(ResultRing const&) = delete;
+		
+		/** @brief returns slot storage for message, marked as being written */
+		char* beginSlot(uint64_t sequence, size_t* capacity);
+		
+		/** @brief marks slot complete, advances published count and wakes waiters */
+		void endSlot(uint64_t sequence, size_t bytes);
+		
+	  public:
+		
+		/** @brief static creational method, creates or replaces shared memory object name (e.g. "/sphinx-results"), throws on failure */
+		static ResultRingRef create(const std::string& name, size_t numSlots = 256, size_t slotBytes = 2048)
+		{
+			return ResultRingRef( new ResultRing( name, numSlots, slotBytes ) );
+		}
+		
+		/** @brief destructor, unmaps and unlinks shared memory object, readers keep their mappings */
+		~ResultRing();
+		
+		/** @brief copies decoder hypothesis into next slot, finals also carry utterance confidence and segments, called from the decode thread */
+		void publish(ps_decoder_t* decoder, Kind kind, uint32_t session, uint64_t utterance, bool cut = false);
+		
+		/** @brief marks utterance whose partials were published as ended without a final, called from the decode thread */
+		void publishDiscard(uint32_t session, uint64_t utterance);
+		
+		/** @brief returns messages published */
+		uint64_t getPublished() const { return mNext; }
+	};
+	
+	/** @brief reads a ResultRing from any process, each reader keeps its own position */
+	class ResultRingReader
+	{
+	  public:
+		
+		/** @brief message copied out of ring */
+		struct Message
+		{
+			ResultRing::Kind					kind;			//!< partial, final or discard
+			uint64_t							sequence;		//!< ring sequence number
+			uint32_t							session;		//!< recognizer session id
+			uint64_t							utterance;		//!< index of utterance within session, assigned when it starts
+			uint64_t							timeUs;			//!< wall clock at publish, microseconds since epoch
+			int32_t								score;			//!< best path score
+			float								confidence;		//!< utterance posterior probability, finals only
+			int32_t								frames;			//!< frames decoded
+			bool								cut;			//!< ended at maximum length
+			bool								truncated;		//!< text or segments did not fit slot
+			std::string							hypothesis;		//!< hypothesis
+			size_t								numSegments;	//!< valid segments
+			std::vector<ResultSink::Segment>	segments;		//!< word segmentation, finals only
+		};
+		
+	  private:
+		
+		int						mFd;		//!< shared memory descriptor
+		ResultRing::Header*		mHeader;	//!< mapped header
+		const char*				mSlots;		//!< mapped slots
+		size_t					mMapSize;	//!< mapping size
+		uint64_t				mNext;		//!< next sequence number to read
+		uint64_t				mLost;		//!< messages overwritten before being read
+		std::vector<char>		mBuffer;	//!< slot copy, reused
+		
+		ResultRingReader(const std::string& name, bool fromStart);
+		
+		ResultRingReader(ResultRingReader const&) = delete;
+		ResultRingReader& operator=(ResultRingReader const&) = delete;
+		
+	  public:
+		
+		/** @brief static creational method, starts at the oldest retained message or only at new ones, throws if ring does not exist */
+		static ResultRingReaderRef create(const std::string& name, bool fromStart = false)
+		{
+			return ResultRingReaderRef( new ResultRingReader( name, fromStart ) );
+		}
+		
+		/** @brief destructor */
+		~ResultRingReader();
+		
+		/** @brief copies next message without blocking, returns false if none is available */
+		bool poll(Message* output);
+		
+		/** @brief waits up to timeoutMs for next message, returns false on timeout */
+		bool wait(Message* output, int timeoutMs);
+		
+		/** @brief returns messages overwritten before this reader got to them */
+		uint64_t getLost() const { return mLost; }
+	};
+	
+} // namespace sphinx
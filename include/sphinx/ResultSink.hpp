@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+#include <pocketsphinx.h>
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class ResultSink>		ResultSinkRef;
+	typedef std::shared_ptr<class ResultSinkJson>	ResultSinkJsonRef;
+	typedef std::shared_ptr<class ResultSinkBinary>	ResultSinkBinaryRef;
+	
+	/** @brief receives utterance results on its own thread, the decode thread only copies each result into a recycled slot */
+	class ResultSink
+	{
+	  public:
+		
+		/** @brief recognized word */
+		struct Segment
+		{
+			std::string		word;			//!< word, with alternate pronunciation suffix if any
+			int32_t			startFrame;		//!< first frame
+			int32_t			endFrame;		//!< last frame
+			int32_t			acousticScore;	//!< acoustic score
+			int32_t			languageScore;	//!< language score
+			float			confidence;		//!< posterior probability
+		};
+		
+		/** @brief utterance result, segments beyond numSegments are stale storage kept for reuse */
+		struct Result
+		{
+			uint32_t				session;		//!< recognizer session id
+			uint64_t				utterance;		//!< recognizer utterance index, shared with its result ring
+			uint64_t				timeUs;			//!< wall clock at delivery, microseconds since epoch
+			bool					cut;			//!< ended at maximum length rather than silence
+			std::string				hypothesis;		//!< best hypothesis
+			int32_t					score;			//!< best path score
+			float					confidence;		//!< utterance posterior probability
+			int32_t					frames;			//!< frames decoded
+			double					speechSeconds;	//!< audio decoded
+			double					cpuSeconds;		//!< decoder cpu time
+			double					wallSeconds;	//!< decoder wall time
+			size_t					numSegments;	//!< valid segments
+			std::vector<Segment>	segments;		//!< word segmentation
+		};
+		
+	  private:
+		
+		std::vector<Result>			mSlots;			//!< result storage, recycled
+		uint64_t					mHead;			//!< next slot to fill
+		uint64_t					mTail;			//!< next slot to consume
+		std::atomic<uint64_t>		mDropped;		//!< results dropped because every slot was pending
+		std::mutex					mMutex;			//!< guards head, tail and stop flag
+		std::condition_variable		mCv;			//!< signals published results
+		bool						mStop;			//!< consumer stop flag
+		std::thread					mThread;		//!< consumer thread
+		
+		/** @brief consumer loop */
+		void run();
+		
+	  protected:
+		
+		/** @brief constructor, holds up to capacity pending results */
+		ResultSink(size_t capacity);
+		
+		/** @brief starts consumer thread, called by derived constructors once consume can run */
+		void start();
+		
+		/** @brief drains pending results and stops consumer thread, must be called by derived destructors */
+		void stop();
+		
+		/** @brief handles one result on the consumer thread */
+		virtual void consume(const Result& result) = 0;
+		
+	  public:
+		
+		/** @brief virtual destructor */
+		virtual ~ResultSink();
+		
+		/** @brief copies finished utterance from decoder into a free slot, dropping it if none is free, called from the decode thread */
+		void publish(ps_decoder_t* decoder, uint32_t session, uint64_t utterance, bool cut);
+		
+		/** @brief returns results dropped because the consumer fell behind */
+		uint64_t getDropped() const { return mDropped.load(); }
+	};
+	
+	/** @brief writes results to a file descriptor as newline-delimited JSON */
+	class ResultSinkJson : public ResultSink
+	{
+	  private:
+		
+		int						mFd;		//!< output descriptor
+		bool					mOwnsFd;	//!< close descriptor on destruction flag
+		std::string				mBuffer;	//!< serialization buffer, reused
+		std::atomic<uint64_t>	mErrors;	//!< failed writes
+		
+		ResultSinkJson(int fd, bool ownsFd, size_t capacity);
+		
+	  protected:
+		
+		void consume(const Result& result) override;
+		
+	  public:
+		
+		/** @brief static creational method, optionally takes ownership of descriptor */
+		static ResultSinkJsonRef create(int fd, bool ownsFd = false, size_t capacity = 16) { return ResultSinkJsonRef( new ResultSinkJson( fd, ownsFd, capacity ) ); }
+		
+		/** @brief destructor, drains pending results */
+		~ResultSinkJson();
+		
+		/** @brief returns failed writes */
+		uint64_t getErrors() const { return mErrors.load(); }
+	};
+	
+	/** @brief writes results to a file descriptor as length-prefixed little-endian records
+	 
+	 Each record is a uint32 byte count followed by: uint8 version (1), uint32 session, uint64 utterance, uint64 time (us),
+	 uint8 cut, int32 score, float32 confidence, int32 frames, float64 speech, cpu and wall seconds, uint16 hypothesis
+	 length and bytes, uint16 segment count, then per segment uint16 word length and bytes, int32 start and end frame,
+	 int32 acoustic and language score and float32 confidence.
+	 */
+	class ResultSinkBinary : public ResultSink
+	{
+	  private:
+		
+		int						mFd;		//!< output descriptor
+		bool					mOwnsFd;	//!< close descriptor on destruction flag
+		std::vector<char>		mBuffer;	//!< serialization buffer, reused
+		std::atomic<uint64_t>	mErrors;	//!< failed writes
+		
+		ResultSinkBinary(int fd, bool ownsFd, size_t capacity);
+		
+	  protected:
+		
+		void consume(const Result& result) override;
+		
+	  public:
+		
+		/** @brief static creational method, optionally takes ownership of descriptor */
+		static ResultSinkBinaryRef create(int fd, bool ownsFd = false, size_t capacity = 16) { return ResultSinkBinaryRef( new ResultSinkBinary( fd, ownsFd, capacity ) ); }
+		
+		/** @brief destructor, drains pending results */
+		~ResultSinkBinary();
+		
+		/** @brief returns failed writes */
+		uint64_t getErrors() const { return mErrors.load(); }
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,132 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+
+#include "sphinx/LoadShedder.hpp"
+
+namespace sphinx {
+	
+	typedef std::shared_ptr<class SessionRecorder>	SessionRecorderRef;
+	typedef std::shared_ptr<class SessionReader>	SessionReaderRef;
+	
+	/** @brief session log record types, stored as a byte followed by a microsecond timestamp */
+	enum class SessionRecord : uint8_t
+	{
+		Start			= 1,	//!< ps_start_utt
+		Audio			= 2,	//!< ps_process_raw, followed by sample count and int16 samples
+		End				= 3,	//!< ps_end_utt delivered to handler, followed by cut flag byte
+		Abort			= 4,	//!< ps_end_utt without delivery
+		Search			= 5,	//!< active search changed, followed by name length and name
+		Reconfigure		= 6		//!< load shedding level changed, followed by level and the beam, wbeam, maxhmmpf and ds it applied
+	};
+	
+	/** @brief writes compact binary log of decoder input, called from the decode thread only */
+	class SessionRecorder
+	{
+	  private:
+		
+		std::ofstream							mFile;			//!< output file
+		std::chrono::steady_clock::time_point	mBegin;			//!< session start
+		std::string								mSearch;		//!< last recorded search name
+		
+		/** @brief private constructor */
+		SessionRecorder(const ci::fs::path& logPath);
+		
+		/** @brief writes record type and timestamp */
+		void header(SessionRecord type);
+		
+	  public:
+		
+		/** @brief static creational method, throws if file cannot be opened */
+		static SessionRecorderRef create(const ci::fs::path& logPath) { return SessionRecorderRef( new SessionRecorder( logPath ) ); }
+		
+		/** @brief records utterance start */
+		void start();
+		
+		/** @brief records decoder input */
+		void audio(const int16_t* data, size_t size);
+		
+		/** @brief records utterance delivered to handler */
+		void end(bool cut);
+		
+		/** @brief records utterance ended without delivery */
+		void abort();
+		
+		/** @brief records active search if changed since last call */
+		void search(const char* name);
+		
+		/** @brief records load shedding level change and the pruning in effect after it */
+		void reconfigure(size_t level, const LoadShedder::Level& pruning);
+		
+		/** @brief flushes buffered records to file */
+		void flush() { mFile.flush(); }
+	};
+	
+	/** @brief reads session log records in order */
+	class SessionReader
+	{
+	  public:
+		
+		/** @brief decoded record, samples valid until next read */
+		struct Entry
+		{
+			SessionRecord			type;		//!< record type
+			uint64_t				timeUs;		//!< microseconds since session start
+			std::vector<int16_t>	samples;	//!< decoder input, for audio records
+			std::string				name;		//!< search name, for search records
+			uint32_t				value;		//!< cut flag or load shedding level
+			LoadShedder::Level		pruning;	//!< pruning in effect, for reconfigure records
+		};
+		
+	  private:
+		
+		std::string		mData;		//!< log contents
+		size_t			mPos;		//!< read position
+		
+		/** @brief private constructor */
+		SessionReader(const ci::fs::path& logPath);
+		
+		/** @brief copies bytes from log, throws if truncated */
+		void take(void* dest, size_t size);
+		
+	  public:
+		
+		/** @brief static creational method, throws if file cannot be read or is not a session log */
+		static SessionReaderRef create(const ci::fs::path& logPath) { return SessionReaderRef( new SessionReader( logPath ) ); }
+		
+		/** @brief reads next record, returns false at end of log */
+		bool next(Entry* entry);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,161 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "sphinx/ThreadPolicy.hpp"
+
+namespace sphinx {
+	
+	/** @brief recognizer counters and histograms, updated lock-free on the decode thread and snapshotted on read */
+	class Stats
+	{
+	  public:
+		
+		/** @brief snapshot of a histogram, counts[i] holds values <= bounds[i], last count holds overflow */
+		struct HistogramSnapshot
+		{
+			std::vector<double>		bounds;		//!< bucket upper bounds
+			std::vector<uint64_t>	counts;		//!< bucket counts, one more than bounds
+			uint64_t				count;		//!< number of values
+			double					sum;		//!< sum of values
+			
+			/** @brief returns mean value, or zero if empty */
+			double mean() const { return count > 0 ? sum / count : 0.0; }
+		};
+		
+		/** @brief fixed-bucket histogram with atomic counts */
+		class Histogram
+		{
+		  private:
+			
+			std::vector<double>						mBounds;	//!< bucket upper bounds, ascending
+			std::unique_ptr<std::atomic<uint64_t>[]>	mCounts;	//!< bucket counts
+			std::atomic<uint64_t>					mCount;		//!< number of values
+			std::atomic<double>						mSum;		//!< sum of values
+			
+		  public:
+			
+			/** @brief constructor */
+			Histogram(const std::vector<double>& bounds);
+			
+			/** @brief adds value */
+			void record(double value);
+			
+			/** @brief returns copy of current counts */
+			HistogramSnapshot snapshot() const;
+		};
+		
+		/** @brief snapshot of all statistics */
+		struct Snapshot
+		{
+			uint64_t			utterances;			//!< utterances delivered to handler
+			uint64_t			discarded;			//!< utterances dropped by endpointer
+			uint64_t			cut;				//!< utterances cut at maximum length
+			uint64_t			blocks;				//!< blocks captured
+			uint64_t			samples;			//!< samples decoded
+			uint64_t			frames;				//!< feature frames searched
+			uint64_t			droppedBlocks;		//!< blocks lost before decoding
+			uint64_t			droppedSamples;		//!< samples lost before decoding
+			uint64_t			queueDepth;			//!< samples awaiting decode
+			uint64_t			maxQueueDepth;		//!< largest samples awaiting decode
+			double				speechSeconds;		//!< decoder total speech time (ps_get_all_time)
+			double				cpuSeconds;			//!< decoder total CPU time
+			double				wallSeconds;		//!< decoder total wall time
+			HistogramSnapshot	uttSpeech;			//!< per-utterance speech seconds
+			HistogramSnapshot	uttCpu;				//!< per-utterance CPU seconds
+			HistogramSnapshot	uttWall;			//!< per-utterance wall seconds
+			HistogramSnapshot	rtf;				//!< per-utterance real-time factor (CPU / speech)
+			HistogramSnapshot	latencyMs;			//!< end-of-speech decision to handler dispatch
+			ThreadPolicy::Result	threadPolicy;	//!< decode thread policy in effect
+			
+			/** @brief returns overall real-time factor */
+			double realTimeFactor() const { return speechSeconds > 0.0 ? cpuSeconds / speechSeconds : 0.0; }
+		};
+		
+	  private:
+		
+		std::atomic<uint64_t>	mUtterances;
+		std::atomic<uint64_t>	mDiscarded;
+		std::atomic<uint64_t>	mCut;
+		std::atomic<uint64_t>	mBlocks;
+		std::atomic<uint64_t>	mSamples;
+		std::atomic<uint64_t>	mFrames;
+		std::atomic<uint64_t>	mDroppedBlocks;
+		std::atomic<uint64_t>	mDroppedSamples;
+		std::atomic<uint64_t>	mQueueDepth;
+		std::atomic<uint64_t>	mMaxQueueDepth;
+		std::atomic<double>		mSpeechSeconds;
+		std::atomic<double>		mCpuSeconds;
+		std::atomic<double>		mWallSeconds;
+		
+		Histogram				mUttSpeech;
+		Histogram				mUttCpu;
+		Histogram				mUttWall;
+		Histogram				mRtf;
+		Histogram				mLatencyMs;
+		
+		mutable std::mutex		mPolicyMutex;	//!< guards thread policy, written once per thread start
+		ThreadPolicy::Result	mThreadPolicy;	//!< decode thread policy in effect
+		
+	  public:
+		
+		/** @brief constructor */
+		Stats();
+		
+		/** @brief records captured block */
+		void recordBlock() { mBlocks.fetch_add( 1, std::memory_order_relaxed ); }
+		
+		/** @brief records decoded samples */
+		void recordSamples(size_t count) { mSamples.fetch_add( count, std::memory_order_relaxed ); }
+		
+		/** @brief records audio lost before decoding */
+		void recordDrop(size_t blocks, size_t samples);
+		
+		/** @brief records samples awaiting decode */
+		void recordQueueDepth(size_t samples);
+		
+		/** @brief records utterance dropped by endpointer */
+		void recordDiscard() { mDiscarded.fetch_add( 1, std::memory_order_relaxed ); }
+		
+		/** @brief records delivered utterance with decoder timings and dispatch latency */
+		void recordUtterance(bool cut, int frames, double speech, double cpu, double wall, double latencyMs);
+		
+		/** @brief records decoder totals */
+		void recordTotals(double speech, double cpu, double wall);
+		
+		/** @brief records decode thread policy in effect, off the hot path */
+		void recordThreadPolicy(const ThreadPolicy::Result& policy);
+		
+		/** @brief returns copy of all statistics, safe to call from any thread */
+		Snapshot snapshot() const;
+	};
+	
+} // namespace sphinx
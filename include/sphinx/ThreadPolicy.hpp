@@ -0,0 +1,95 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace sphinx {
+	
+	/** @brief scheduling, priority, affinity and naming for decode threads, applied by the thread itself */
+	class ThreadPolicy
+	{
+	  public:
+		
+		/** @brief scheduling class */
+		enum class Scheduler { Default, Fifo, RoundRobin };
+		
+		/** @brief policy in effect after apply, which degrades to what the process is permitted */
+		struct Result
+		{
+			Scheduler			scheduler;	//!< scheduling class in effect
+			int					priority;	//!< real-time priority in effect, zero for default scheduling
+			int					nice;		//!< nice level in effect
+			std::vector<int>	cpus;		//!< CPUs thread may run on, empty if unknown
+			bool				named;		//!< thread name set flag
+			std::string			errors;		//!< settings that could not be applied, semicolon separated
+		};
+		
+	  private:
+		
+		std::string			mName;			//!< thread name, truncated to 15 characters
+		Scheduler			mScheduler;		//!< requested scheduling class
+		int					mPriority;		//!< requested real-time priority
+		bool				mSetNice;		//!< nice level requested flag
+		int					mNice;			//!< requested nice level
+		std::vector<int>	mCpus;			//!< requested CPU affinity
+		
+	  public:
+		
+		/** @brief default constructor, leaves threads unchanged */
+		ThreadPolicy() : mScheduler( Scheduler::Default ), mPriority( 0 ), mSetNice( false ), mNice( 0 ) { /* no-op */ }
+		
+		/** @brief sets thread name */
+		ThreadPolicy& name(const std::string& value) { mName = value; return *this; }
+		
+		/** @brief requests real-time scheduling at priority, clamped to the scheduler's range, falls back to default scheduling if not permitted */
+		ThreadPolicy& scheduler(Scheduler value, int priority = 0) { mScheduler = value; mPriority = priority; return *this; }
+		
+		/** @brief requests nice level for default scheduling (per-thread on Linux only) */
+		ThreadPolicy& nice(int value) { mSetNice = true; mNice = value; return *this; }
+		
+		/** @brief restricts thread to CPUs (Linux only) */
+		ThreadPolicy& affinity(const std::vector<int>& cpus) { mCpus = cpus; return *this; }
+		
+		const std::string& getName() const { return mName; }
+		Scheduler getScheduler() const { return mScheduler; }
+		int getPriority() const { return mPriority; }
+		const std::vector<int>& getAffinity() const { return mCpus; }
+		
+		/** @brief returns copy with name suffixed, for thread pools */
+		ThreadPolicy withSuffix(const std::string& suffix) const { ThreadPolicy p( *this ); p.mName += suffix; return p; }
+		
+		/** @brief applies policy to calling thread, never throws, returns what took effect */
+		Result apply() const;
+		
+		/** @brief returns scheduler name */
+		static const char* toString(Scheduler scheduler);
+		
+		/** @brief returns cpu seconds used by calling thread, where sphinxbase timers count the whole process */
+		static double getThreadCpuSeconds();
+	};
+	
+} // namespace sphinx
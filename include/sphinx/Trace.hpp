@@ -0,0 +1,154 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "cinder/Filesystem.h"
+
+namespace sphinx {
+	
+	//! compile-time trace span switch for SPHINX_TIMED_SCOPE sites, enabled by building with SPHINX_TRACE
+#if defined( SPHINX_TRACE )
+	constexpr bool kTraceEnabled = true;
+#else
+	constexpr bool kTraceEnabled = false;
+#endif
+	
+	/** @brief optional Chrome trace-event timeline, buffered in per-thread lock-free rings and written by a background flusher; SPHINX_TIMED_SCOPE sites record spans only when built with SPHINX_TRACE, independently of SPHINX_INSTRUMENT */
+	class Trace
+	{
+	  public:
+		
+		/** @brief timed span, recorded as a complete event when destroyed if tracing was enabled when created */
+		class Scope
+		{
+		  private:
+			
+			const char*		mName;		//!< event name, must be a string literal
+			bool			mActive;	//!< tracing enabled at creation
+			uint64_t		mBegin;		//!< start time
+			
+		  public:
+			
+			/** @brief constructor */
+			Scope(const char* name) : mName( name ), mActive( isEnabled() ), mBegin( mActive ? now() : 0 ) { /* no-op */ }
+			
+			/** @brief destructor */
+			~Scope() { if( mActive ) complete( mName, mBegin, now() - mBegin ); }
+		};
+		
+	  private:
+		
+		static std::atomic<bool> sEnabled;	//!< collecting flag
+		
+	  public:
+		
+		/** @brief begins collecting events into file, rings created afterwards hold ringCapacity events per thread, and up to eight spareRings are registered up front so threads first tracing from a real-time callback, such as the audio thread, claim one without allocating or locking */
+		static void start(const ci::fs::path& jsonPath, size_t ringCapacity = 16384, size_t spareRings = 2);
+		
+		/** @brief stops collecting, writes remaining events and closes file */
+		static void stop();
+		
+		/** @brief returns true while collecting */
+		static bool isEnabled() { return sEnabled.load( std::memory_order_relaxed ); }
+		
+		/** @brief returns microseconds on trace clock */
+		static uint64_t now();
+		
+		/** @brief records complete event, name must be a string literal */
+		static void complete(const char* name, uint64_t beginUs, uint64_t durationUs);
+		
+		/** @brief records instant event with optional argument, which is copied and truncated to 31 characters */
+		static void instant(const char* name, const char* arg = NULL);
+		
+		/** @brief records counter value */
+		static void counter(const char* name, int64_t value);
+		
+		/** @brief returns new session id, shown as a process in trace viewers */
+		static uint32_t newSession();
+		
+		/** @brief tags calling thread's events with session id */
+		static void setSession(uint32_t session);
+		
+		/** @brief names calling thread within its current session without allocating, name must be a string literal or outlive the trace; a thread claims a ring with its first event while tracing and returns it on exit */
+		static void setThreadName(const char* name);
+		
+		/** @brief returns events lost to full rings */
+		static uint64_t getDroppedEvents();
+	};
+	
+	/** @brief span name kept by disabled instruments, empty unless built with SPHINX_TRACE */
+	template<bool Enabled = kTraceEnabled>
+	class TraceName
+	{
+	  public:
+		
+		/** @brief constructor */
+		constexpr TraceName(const char*) { }
+	};
+	
+	template<>
+	class TraceName<true>
+	{
+	  private:
+		
+		const char*		mName;		//!< span name, a string literal
+		
+	  public:
+		
+		/** @brief constructor */
+		constexpr TraceName(const char* name) : mName( name ) { }
+		
+		/** @brief returns span name */
+		constexpr const char* get() const { return mName; }
+	};
+	
+	/** @brief trace span of enclosing scope, empty unless built with SPHINX_TRACE */
+	template<bool Enabled = kTraceEnabled>
+	class TraceSpan
+	{
+	  public:
+		
+		/** @brief constructor */
+		TraceSpan(const TraceName<Enabled>&) { /* no-op */ }
+	};
+	
+	template<>
+	class TraceSpan<true>
+	{
+	  private:
+		
+		Trace::Scope	mScope;		//!< span, recorded while tracing
+		
+	  public:
+		
+		/** @brief constructor */
+		TraceSpan(const TraceName<true>& name) : mScope( name.get() ) { /* no-op */ }
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,119 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "cinder/Filesystem.h"
+
+#include "sphinx/RecognizerConfig.hpp"
+
+namespace sphinx {
+	
+	/** @brief offline tuner decoding a labelled corpus across a grid of pruning parameters */
+	class Tuner
+	{
+	  public:
+		
+		/** @brief labelled corpus entry, audio is raw or WAV 16 kHz mono int16 */
+		struct Utterance
+		{
+			ci::fs::path			audioPath;		//!< audio file
+			std::string				reference;		//!< reference transcript
+			std::vector<int16_t>	samples;		//!< loaded audio
+		};
+		
+		/** @brief measurements for one grid point */
+		struct Result
+		{
+			std::string				label;			//!< parameter description
+			RecognizerConfig		config;			//!< configuration decoded with
+			double					rtf;			//!< CPU seconds per audio second
+			double					latencyMs;		//!< mean time from end of audio to final hypothesis
+			double					wer;			//!< word error rate over corpus
+			bool					pareto;			//!< true if no other result is better on all measures
+		};
+		
+	  private:
+		
+		RecognizerConfig						mBase;			//!< base configuration
+		std::string								mJsgf;			//!< grammar decoded against
+		std::vector<Utterance>					mCorpus;		//!< labelled corpus
+		size_t									mNumThreads;	//!< worker count
+		
+		std::vector<double>						mBeams;			//!< -beam axis
+		std::vector<double>						mWbeams;		//!< -wbeam axis
+		std::vector<int>						mMaxhmmpfs;		//!< -maxhmmpf axis
+		std::vector<int>						mDss;			//!< -ds axis
+		std::vector<int>						mTopns;			//!< -topn axis
+		std::vector<int>						mPlWindows;		//!< -pl_window axis
+		
+		/** @brief expands axes into configurations */
+		std::vector<Result> expandGrid() const;
+		
+		/** @brief decodes corpus with result configuration and fills in measurements */
+		void evaluate(Result* result) const;
+		
+	  public:
+		
+		/** @brief constructor, base configuration supplies model, dictionary and fixed options */
+		Tuner(const RecognizerConfig& base, const std::string& jsgfData);
+		
+		/** @brief loads corpus list file with one "audio-path<TAB>transcript" line per utterance, paths relative to list */
+		Tuner& corpus(const ci::fs::path& listPath);
+		
+		/** @brief adds single corpus entry */
+		Tuner& add(const ci::fs::path& audioPath, const std::string& reference);
+		
+		/** @brief sets number of parallel decoders, defaults to hardware concurrency; decoders are loaded one at a time, then decode in parallel */
+		Tuner& threads(size_t count) { mNumThreads = count > 0 ? count : 1; return *this; }
+		
+		/** @brief sets axis values, an empty axis keeps the base configuration value */
+		Tuner& beams(const std::vector<double>& values) { mBeams = values; return *this; }
+		Tuner& wbeams(const std::vector<double>& values) { mWbeams = values; return *this; }
+		Tuner& maxhmmpfs(const std::vector<int>& values) { mMaxhmmpfs = values; return *this; }
+		Tuner& dss(const std::vector<int>& values) { mDss = values; return *this; }
+		Tuner& topns(const std::vector<int>& values) { mTopns = values; return *this; }
+		Tuner& plWindows(const std::vector<int>& values) { mPlWindows = values; return *this; }
+		
+		/** @brief decodes corpus at every grid point and marks Pareto-optimal results */
+		std::vector<Result> run() const;
+		
+		/** @brief marks results not dominated on RTF, latency and WER */
+		static void markPareto(std::vector<Result>* results);
+		
+		/** @brief writes results as CSV */
+		static void writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath);
+		
+		/** @brief loads raw or WAV 16 kHz mono int16 audio */
+		static void loadAudio(const ci::fs::path& audioPath, std::vector<int16_t>* samples);
+		
+		/** @brief returns word error rate of hypothesis against reference */
+		static double wordErrorRate(const std::string& reference, const std::string& hypothesis);
+	};
+	
+} // namespace sphinx
@@ -0,0 +1,42 @@
+# CMake package for the block, found by ci_make_app( BLOCKS ... ) when the block directory is named ciSpeech
+
+if( NOT TARGET ciSpeech )
+	get_filename_component( CISPEECH_PATH "${CMAKE_CURRENT_LIST_DIR}/../.." ABSOLUTE )
+	get_filename_component( CINDER_PATH "${CMAKE_CURRENT_LIST_DIR}/../../../.." ABSOLUTE )
+
+	file( GLOB CISPEECH_SOURCES "${CISPEECH_PATH}/src/sphinx/*.cpp" )
+	add_library( ciSpeech ${CISPEECH_SOURCES} )
+
+	target_include_directories( ciSpeech PUBLIC "${CISPEECH_PATH}/include" )
+	target_include_directories( ciSpeech SYSTEM PUBLIC "${CISPEECH_PATH}/include/pocketsphinx" "${CISPEECH_PATH}/include/sphinxbase" )
+	target_include_directories( ciSpeech SYSTEM BEFORE PUBLIC "${CINDER_PATH}/include" )
+
+	if( NOT TARGET cinder )
+		include( "${CINDER_PATH}/proj/cmake/configure.cmake" )
+		find_package( cinder REQUIRED PATHS
+			"${CINDER_PATH}/${CINDER_LIB_DIRECTORY}"
+			"$ENV{CINDER_PATH}/${CINDER_LIB_DIRECTORY}" )
+	endif()
+	target_link_libraries( ciSpeech PUBLIC cinder )
+
+	# Per-thread heap allocation counting, replaces global operator new/delete (and malloc on glibc) in every linked target:
+	option( CISPEECH_COUNT_ALLOCATIONS "Count heap allocations per thread" OFF )
+	if( CISPEECH_COUNT_ALLOCATIONS )
+		target_compile_definitions( ciSpeech PUBLIC SPHINX_COUNT_ALLOCATIONS )
+	endif()
+
+	# Trace spans at timed scopes, compiled out entirely unless enabled:
+	option( CISPEECH_TRACE "Record trace spans at timed scopes" OFF )
+	if( CISPEECH_TRACE )
+		target_compile_definitions( ciSpeech PUBLIC SPHINX_TRACE )
+	endif()
+
+	# Prebuilt pocketsphinx on OS X, system libraries elsewhere:
+	if( APPLE )
+		target_link_libraries( ciSpeech PUBLIC "${CISPEECH_PATH}/lib/macosx/libpocketsphinx.a" "${CISPEECH_PATH}/lib/macosx/libsphinxbase.a" )
+	else()
+		find_library( POCKETSPHINX_LIBRARY pocketsphinx )
+		find_library( SPHINXBASE_LIBRARY sphinxbase )
+		target_link_libraries( ciSpeech PUBLIC ${POCKETSPHINX_LIBRARY} ${SPHINXBASE_LIBRARY} )
+	endif()
+endif()
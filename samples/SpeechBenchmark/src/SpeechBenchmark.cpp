@@ -0,0 +1,168 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ Headless benchmark and check runner for the speech recognizer, needs no audio device or window.
+ 
+ usage: SpeechBenchmark load <assets-dir> [report-path]
+		model load, grammar compile and decode throughput (JSON report); on Linux, fails if
+		process memory cannot be read from smaps_rollup
+ 
+		SpeechBenchmark convert [report-path]
+		device audio to decoder input conversion kernels (CSV report); when built with
+		SPHINX_COUNT_ALLOCATIONS, fails if the polyphase resampler allocates per block
+ 
+		SpeechBenchmark audit <assets-dir> [report-path]
+		decode-thread heap allocations in steady state with each built-in handler, a result
+		sink and a result ring attached (CSV report); needs SPHINX_COUNT_ALLOCATIONS and fails
+		if the wrapper allocates once warm
+ 
+		SpeechBenchmark instrument [report-path]
+		instrumentation cost per block (CSV report), for comparing builds with and without
+		SPHINX_INSTRUMENT and SPHINX_TRACE; disabled instruments are checked empty at compile time
+ 
+ Exits non-zero if a command fails, so each can run as a test.
+ */
+
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+
+#include "sphinx/AllocationAudit.hpp"
+#include "sphinx/AllocationCounter.hpp"
+#include "sphinx/Benchmark.hpp"
+#include "sphinx/ConversionBenchmark.hpp"
+#include "sphinx/InstrumentBenchmark.hpp"
+#include "sphinx/MemoryReport.hpp"
+
+using namespace sphinx;
+
+static int runLoad(const ci::fs::path& assetsPath, const ci::fs::path& reportPath)
+{
+	Benchmark::Result result = Benchmark( assetsPath ).run();
+	
+	printf( "audio %.1f s, model load %.1f ms, grammar compile %.1f ms\n", result.audioSeconds, result.modelLoadMs, result.grammarCompileMs );
+	printf( "rtf %.3f, wall rtf %.3f, finalize %.2f ms, peak rss %zu kB\n", result.rtf, result.wallRtf, result.finalizeMs, result.peakRssKb );
+	for( const auto& t : result.throughput )
+		printf( "threads %zu: %.1f audio s/s, rtf %.3f\n", t.threads, t.audioPerSec, t.rtf );
+	
+	// Process figures in memory reports come from smaps_rollup, which always shows resident bytes:
+	size_t mappedBytes, privateBytes;
+	bool measured = MemoryReport::measureProcess( &mappedBytes, &privateBytes );
+	printf( "process mapped %zu kB, private dirty %zu kB\n", mappedBytes / 1024, privateBytes / 1024 );
+	
+	if( ! reportPath.empty() )
+		Benchmark::writeReport( result, reportPath );
+#if defined( __linux__ )
+	if( ! measured ) {
+		fprintf( stderr, "load: process memory could not be read\n" );
+		return 1;
+	}
+#else
+	(void)measured;
+#endif
+	return 0;
+}
+
+static int runConvert(const ci::fs::path& reportPath)
+{
+	std::vector<ConversionBenchmark::Result> results = ConversionBenchmark().run();
+	
+	bool counted = AllocationCounter::isEnabled();
+	int status = 0;
+	for( const auto& r : results ) {
+		printf( "%-16s %6zu Hz %zu ch %5zu frames: %7.2f ns/sample", r.kernel.c_str(), r.sampleRate, r.numChannels, r.blockSize, r.nsPerSample );
+		if( counted )
+			printf( ", %.2f allocs/block", r.allocsPerBlock );
+		printf( "\n" );
+		
+		// Recognizer's own polyphase path must not allocate once warm, other rates go through Cinder's converter:
+		if( counted && r.kernel == "resampler" && r.sampleRate % 16000 == 0 && r.allocsPerBlock > 0.0 ) {
+			fprintf( stderr, "convert: resampler allocates %.2f times per block\n", r.allocsPerBlock );
+			status = 1;
+		}
+	}
+	
+	if( ! reportPath.empty() )
+		ConversionBenchmark::writeReport( results, reportPath );
+	return status;
+}
+
+static int runAudit(const ci::fs::path& assetsPath, const ci::fs::path& reportPath)
+{
+	std::vector<AllocationAudit::Result> results = AllocationAudit( assetsPath ).run();
+	for( const auto& r : results )
+		printf( "%-10s %zu blocks, %zu utterances: wrapper %llu allocs %llu bytes, decoder %llu allocs %llu bytes\n", r.handler.c_str(), r.blocks, r.utterances, (unsigned long long)r.wrapperAllocs, (unsigned long long)r.wrapperBytes, (unsigned long long)r.decoderAllocs, (unsigned long long)r.decoderBytes );
+	
+	if( ! reportPath.empty() )
+		AllocationAudit::writeReport( results, reportPath );
+	AllocationAudit::check( results );
+	return 0;
+}
+
+static int runInstrument(const ci::fs::path& reportPath)
+{
+	std::vector<InstrumentBenchmark::Result> results = InstrumentBenchmark().run();
+	for( const auto& r : results )
+		printf( "%-16s %7.2f ns/block, overhead %6.2f ns, %zu instrument bytes\n", r.variant.c_str(), r.nsPerIteration, r.overheadNs, r.instrumentBytes );
+	
+	if( ! reportPath.empty() )
+		InstrumentBenchmark::writeReport( results, reportPath );
+	return 0;
+}
+
+static int usage(const char* name)
+{
+	fprintf( stderr, "usage: %s load <assets-dir> [report-path]\n", name );
+	fprintf( stderr, "       %s convert [report-path]\n", name );
+	fprintf( stderr, "       %s audit <assets-dir> [report-path]\n", name );
+	fprintf( stderr, "       %s instrument [report-path]\n", name );
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	if( argc < 2 )
+		return usage( argv[ 0 ] );
+	
+	std::string command = argv[ 1 ];
+	auto arg = [argc, argv](int index) { return index < argc ? ci::fs::path( argv[ index ] ) : ci::fs::path(); };
+	
+	try {
+		if( command == "load" && argc >= 3 )
+			return runLoad( arg( 2 ), arg( 3 ) );
+		if( command == "convert" )
+			return runConvert( arg( 2 ) );
+		if( command == "audit" && argc >= 3 )
+			return runAudit( arg( 2 ), arg( 3 ) );
+		if( command == "instrument" )
+			return runInstrument( arg( 2 ) );
+	}
+	catch( const std::exception& e ) {
+		fprintf( stderr, "%s: %s\n", command.c_str(), e.what() );
+		return 1;
+	}
+	
+	return usage( argv[ 0 ] );
+}
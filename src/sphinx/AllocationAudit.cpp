@@ -0,0 +1,250 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/AllocationAudit.hpp"
+#include "sphinx/AllocationCounter.hpp"
+#include "sphinx/AudioSource.hpp"
+#include "sphinx/Benchmark.hpp"
+#include "sphinx/Recognizer.hpp"
+#include "sphinx/Tuner.hpp"
+
+#include <mutex>
+#include <fstream>
+#include <stdexcept>
+#include <condition_variable>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sphinx {
+	
+	/** @brief allocation counts of the decode thread at one point */
+	struct AllocationSample
+	{
+		uint64_t	news;			//!< operator new calls
+		uint64_t	newBytes;		//!< operator new bytes
+		uint64_t	mallocs;		//!< malloc family calls
+		uint64_t	mallocBytes;	//!< malloc family bytes
+		
+		static AllocationSample now()
+		{
+			return { AllocationCounter::getThreadCount(), AllocationCounter::getThreadBytes(), AllocationCounter::getThreadMallocCount(), AllocationCounter::getThreadMallocBytes() };
+		}
+	};
+	
+	/** @brief source forwarding PCM blocks, sampling the reading thread's counters at the start of steady state and at exhaustion */
+	class AuditSource : public AudioSource
+	{
+	  private:
+		
+		AudioSourceRef			mSource;		//!< wrapped source
+		size_t					mWarmupBlocks;	//!< blocks read before steady state
+		size_t					mBlocks;		//!< blocks read
+		AllocationSample		mBegin;			//!< counters at steady state start
+		AllocationSample		mEnd;			//!< counters at exhaustion
+		std::mutex				mMutex;			//!< guards exhaustion flag
+		std::condition_variable	mCv;			//!< signals exhaustion
+		bool					mDone;			//!< exhaustion flag
+		
+	  public:
+		
+		AuditSource(const AudioSourceRef& source, size_t warmupBlocks) :
+			mSource( source ), mWarmupBlocks( warmupBlocks ), mBlocks( 0 ), mBegin(), mEnd(), mDone( false )
+		{
+			/* no-op */
+		}
+		
+		size_t getSampleRate() const { return mSource->getSampleRate(); }
+		size_t getNumChannels() const { return mSource->getNumChannels(); }
+		SampleType getSampleType() const { return mSource->getSampleType(); }
+		size_t getMaxFramesPerBlock() const { return mSource->getMaxFramesPerBlock(); }
+		size_t getQueuedFrames() const { return mSource->getQueuedFrames(); }
+		void interrupt() { mSource->interrupt(); }
+		
+		bool read(Block* block)
+		{
+			// Block reads happen between decodes, so counters taken here span whole blocks and utterances:
+			if( mBlocks == mWarmupBlocks )
+				mBegin = AllocationSample::now();
+			if( mSource->read( block ) ) {
+				mBlocks++;
+				return true;
+			}
+			mEnd = AllocationSample::now();
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mDone = true;
+			}
+			mCv.notify_all();
+			return false;
+		}
+		
+		/** @brief returns true between the end of warm-up and exhaustion, called from reading thread */
+		bool isSteady() const { return mBlocks > mWarmupBlocks && ! mDone; }
+		
+		/** @brief waits for exhaustion, returning steady-state block count */
+		size_t wait(AllocationSample* begin, AllocationSample* end)
+		{
+			std::unique_lock<std::mutex> lock( mMutex );
+			mCv.wait( lock, [this]() { return mDone; } );
+			*begin = mBegin;
+			*end = mEnd;
+			return mBlocks > mWarmupBlocks ? mBlocks - mWarmupBlocks : 0;
+		}
+	};
+	
+	/** @brief handler forwarding to a built-in handler and counting steady-state utterances */
+	class AuditHandler : public EventHandler
+	{
+	  private:
+		
+		EventHandlerRef		mHandler;		//!< built-in handler
+		const AuditSource*	mSource;		//!< source, for steady-state detection
+		size_t				mUtterances;	//!< steady-state utterances delivered
+		
+	  public:
+		
+		AuditHandler(const EventHandlerRef& handler, const AuditSource* source) : mHandler( handler ), mSource( source ), mUtterances( 0 ) { /* no-op */ }
+		
+		void event(ps_decoder_t* decoder)
+		{
+			mHandler->event( decoder );
+			if( mSource->isSteady() )
+				mUtterances++;
+		}
+		
+		size_t getUtterances() const { return mUtterances; }
+	};
+	
+	AllocationAudit::AllocationAudit(const RecognizerConfig& config, const std::string& jsgfData) :
+		mConfig( config ),
+		mJsgf( jsgfData ),
+		mBlockFrames( 320 ),
+		mPasses( 3 ),
+		mOutputs( true )
+	{
+		Benchmark::generateSpeechLike( 20.0, &mAudio );
+	}
+	
+	AllocationAudit::AllocationAudit(const ci::fs::path& assetsPath) :
+		AllocationAudit( RecognizerConfig( assetsPath / "en-us", assetsPath / "cmudict-en-us.dict" ), "" )
+	{
+		ci::fs::path jsgfPath = assetsPath / "demo.jsgf";
+		std::ifstream fh( jsgfPath.c_str() );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load file: \"" + jsgfPath.string() + "\"" );
+		mJsgf.assign( ( std::istreambuf_iterator<char>( fh ) ), std::istreambuf_iterator<char>() );
+	}
+	
+	AllocationAudit& AllocationAudit::audio(const ci::fs::path& audioPath)
+	{
+		Tuner::loadAudio( audioPath, &mAudio );
+		if( mAudio.empty() )
+			throw std::runtime_error( "Could not load audio: \"" + audioPath.string() + "\" is empty" );
+		return *this;
+	}
+	
+	std::vector<AllocationAudit::Result> AllocationAudit::run() const
+	{
+		// Warm-up pass grows buffers, handler results and decoder tables to their working sizes:
+		std::vector<int16_t> samples;
+		samples.reserve( mAudio.size() * ( mPasses + 1 ) );
+		for(size_t pass = 0; pass <= mPasses; pass++)
+			samples.insert( samples.end(), mAudio.begin(), mAudio.end() );
+		size_t warmupBlocks = ( mAudio.size() + mBlockFrames - 1 ) / mBlockFrames;
+		
+		const char* names[] = { "basic", "segment", "confidence" };
+		std::vector<Result> results;
+		
+		for(size_t kind = 0; kind < 3; kind++) {
+			RecognizerRef recognizer = Recognizer::create( mConfig );
+			recognizer->addModelJsgf( "audit", mJsgf, true );
+			
+			EventHandlerRef handler;
+			if( kind == 0 )
+				handler = EventHandlerRef( new EventHandlerBasic( [](const std::string&) { } ) );
+			else if( kind == 1 )
+				handler = EventHandlerRef( new EventHandlerSegment( [](const std::vector<std::string>&) { } ) );
+			else
+				handler = EventHandlerRef( new EventHandlerSegmentConfidence( [](const std::vector<std::pair<std::string,float> >&) { } ) );
+			
+			// Decode on the recognizer runner, as fast as the decoder allows:
+			AudioSourcePcmRef pcm = AudioSourcePcm::create( samples.data(), samples.size() );
+			pcm->blockFrames( mBlockFrames ).realtime( false );
+			std::shared_ptr<AuditSource> source( new AuditSource( pcm, warmupBlocks ) );
+			std::shared_ptr<AuditHandler> audit( new AuditHandler( handler, source.get() ) );
+			recognizer->connectEventHandler( audit );
+			
+			// Result outputs copy on the decode thread too, so they are held to the same standard:
+			if( mOutputs ) {
+				int fd = open( "/dev/null", O_WRONLY );
+				if( fd < 0 )
+					throw std::runtime_error( "Could not open \"/dev/null\" for result sink" );
+				recognizer->setResultSink( ResultSinkBinary::create( fd, true ) );
+				recognizer->setResultRing( ResultRing::create( "/sphinx-audit-" + std::to_string( getpid() ) ), 100 );
+			}
+			recognizer->start( source );
+			
+			AllocationSample begin, end;
+			Result r;
+			r.handler = names[ kind ];
+			r.outputs = mOutputs;
+			r.blocks = source->wait( &begin, &end );
+			
+			// Stop runner before reading its utterance count:
+			recognizer.reset();
+			r.utterances = audit->getUtterances();
+			r.wrapperAllocs = end.news - begin.news;
+			r.wrapperBytes = end.newBytes - begin.newBytes;
+			r.decoderAllocs = AllocationCounter::isMallocEnabled() ? ( end.mallocs - begin.mallocs ) - r.wrapperAllocs : 0;
+			r.decoderBytes = AllocationCounter::isMallocEnabled() ? ( end.mallocBytes - begin.mallocBytes ) - r.wrapperBytes : 0;
+			results.push_back( r );
+		}
+		return results;
+	}
+	
+	void AllocationAudit::check(const std::vector<Result>& results)
+	{
+		if( ! AllocationCounter::isEnabled() )
+			throw std::runtime_error( "Could not audit allocations: build with SPHINX_COUNT_ALLOCATIONS" );
+		for( const auto& r : results ) {
+			if( r.utterances == 0 )
+				throw std::runtime_error( "Could not audit allocations: no utterance was delivered to the " + r.handler + " handler" );
+			if( r.wrapperAllocs > 0 )
+				throw std::runtime_error( "Wrapper allocated in steady state with the " + r.handler + " handler: " + std::to_string( r.wrapperAllocs ) + " allocations, " + std::to_string( r.wrapperBytes ) + " bytes over " + std::to_string( r.blocks ) + " blocks" );
+		}
+	}
+	
+	void AllocationAudit::writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath)
+	{
+		std::ofstream fh( csvPath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not write allocation audit report: \"" + csvPath.string() + "\"" );
+		
+		fh << "handler,outputs,blocks,utterances,wrapper_allocs,wrapper_bytes,decoder_allocs,decoder_bytes\n";
+		for( const auto& r : results )
+			fh << r.handler << "," << r.outputs << "," << r.blocks << "," << r.utterances << "," << r.wrapperAllocs << "," << r.wrapperBytes << "," << r.decoderAllocs << "," << r.decoderBytes << "\n";
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,213 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/AllocationCounter.hpp"
+
+#include <new>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined( SPHINX_COUNT_ALLOCATIONS )
+
+static thread_local uint64_t sAllocationCount = 0;
+static thread_local uint64_t sAllocationBytes = 0;
+
+static void* countedAlloc(std::size_t size)
+{
+	sAllocationCount++;
+	sAllocationBytes += size;
+	void* ptr = std::malloc( size > 0 ? size : 1 );
+	if( ! ptr )
+		throw std::bad_alloc();
+	return ptr;
+}
+
+static void* countedAllocNothrow(std::size_t size) noexcept
+{
+	sAllocationCount++;
+	sAllocationBytes += size;
+	return std::malloc( size > 0 ? size : 1 );
+}
+
+void* operator new(std::size_t size) { return countedAlloc( size ); }
+void* operator new[](std::size_t size) { return countedAlloc( size ); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocNothrow( size ); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocNothrow( size ); }
+void operator delete(void* ptr) noexcept { std::free( ptr ); }
+void operator delete[](void* ptr) noexcept { std::free( ptr ); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free( ptr ); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free( ptr ); }
+
+#if defined( __cpp_sized_deallocation )
+void operator delete(void* ptr, std::size_t) noexcept { std::free( ptr ); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free( ptr ); }
+#endif
+
+#if defined( __GLIBC__ )
+
+// C allocations, chiefly pocketsphinx and sphinxbase internals, forwarded to the glibc implementation:
+#define SPHINX_COUNT_MALLOC
+
+extern "C" {
+	void* __libc_malloc(std::size_t size);
+	void* __libc_calloc(std::size_t count, std::size_t size);
+	void* __libc_realloc(void* ptr, std::size_t size);
+}
+
+static thread_local uint64_t sMallocCount = 0;
+static thread_local uint64_t sMallocBytes = 0;
+
+extern "C" void* malloc(std::size_t size) noexcept
+{
+	sMallocCount++;
+	sMallocBytes += size;
+	return __libc_malloc( size );
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) noexcept
+{
+	sMallocCount++;
+	sMallocBytes += count * size;
+	return __libc_calloc( count, size );
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size) noexcept
+{
+	sMallocCount++;
+	sMallocBytes += size;
+	return __libc_realloc( ptr, size );
+}
+
+#endif
+
+#if defined( __cpp_aligned_new )
+
+// Over-aligned allocations (C++17), counted with malloc as well since the aligned path bypasses it:
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) noexcept
+{
+	sAllocationCount++;
+	sAllocationBytes += size;
+#if defined( SPHINX_COUNT_MALLOC )
+	sMallocCount++;
+	sMallocBytes += size;
+#endif
+#if defined( _WIN32 )
+	return _aligned_malloc( size > 0 ? size : 1, std::size_t( alignment ) );
+#else
+	void* ptr = NULL;
+	if( posix_memalign( &ptr, std::max( std::size_t( alignment ), sizeof( void* ) ), size > 0 ? size : 1 ) != 0 )
+		return NULL;
+	return ptr;
+#endif
+}
+
+static void countedAlignedFree(void* ptr) noexcept
+{
+#if defined( _WIN32 )
+	_aligned_free( ptr );
+#else
+	std::free( ptr );
+#endif
+}
+
+static void* countedAlignedAllocOrThrow(std::size_t size, std::align_val_t alignment)
+{
+	void* ptr = countedAlignedAlloc( size, alignment );
+	if( ! ptr )
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAllocOrThrow( size, alignment ); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAllocOrThrow( size, alignment ); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlignedAlloc( size, alignment ); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlignedAlloc( size, alignment ); }
+void operator delete(void* ptr, std::align_val_t) noexcept { countedAlignedFree( ptr ); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { countedAlignedFree( ptr ); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { countedAlignedFree( ptr ); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { countedAlignedFree( ptr ); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { countedAlignedFree( ptr ); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { countedAlignedFree( ptr ); }
+
+#endif
+
+#endif
+
+namespace sphinx {
+	
+	bool AllocationCounter::isEnabled()
+	{
+#if defined( SPHINX_COUNT_ALLOCATIONS )
+		return true;
+#else
+		return false;
+#endif
+	}
+	
+	uint64_t AllocationCounter::getThreadCount()
+	{
+#if defined( SPHINX_COUNT_ALLOCATIONS )
+		return sAllocationCount;
+#else
+		return 0;
+#endif
+	}
+	
+	uint64_t AllocationCounter::getThreadBytes()
+	{
+#if defined( SPHINX_COUNT_ALLOCATIONS )
+		return sAllocationBytes;
+#else
+		return 0;
+#endif
+	}
+	
+	bool AllocationCounter::isMallocEnabled()
+	{
+#if defined( SPHINX_COUNT_MALLOC )
+		return true;
+#else
+		return false;
+#endif
+	}
+	
+	uint64_t AllocationCounter::getThreadMallocCount()
+	{
+#if defined( SPHINX_COUNT_MALLOC )
+		return sMallocCount;
+#else
+		return 0;
+#endif
+	}
+	
+	uint64_t AllocationCounter::getThreadMallocBytes()
+	{
+#if defined( SPHINX_COUNT_MALLOC )
+		return sMallocBytes;
+#else
+		return 0;
+#endif
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,75 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/AudioSource.hpp"
+
+#include <thread>
+#include <algorithm>
+
+namespace sphinx {
+	
+	AudioSourcePcm::AudioSourcePcm(const int16_t* data, size_t numFrames, size_t sampleRate, size_t numChannels) :
+		mData( data ),
+		mNumFrames( numFrames ),
+		mSampleRate( sampleRate ),
+		mNumChannels( std::max<size_t>( numChannels, 1 ) ),
+		mBlockFrames( sampleRate / 50 ),
+		mRealtime( false ),
+		mPosition( 0 )
+	{
+		/* no-op */
+	}
+	
+	AudioSourcePcmRef AudioSourcePcm::create(std::vector<int16_t>&& samples, size_t sampleRate, size_t numChannels)
+	{
+		numChannels = std::max<size_t>( numChannels, 1 );
+		AudioSourcePcmRef source( new AudioSourcePcm( NULL, samples.size() / numChannels, sampleRate, numChannels ) );
+		source->mOwned = std::move( samples );
+		source->mData = source->mOwned.data();
+		return source;
+	}
+	
+	bool AudioSourcePcm::read(Block* block)
+	{
+		if( mPosition >= mNumFrames )
+			return false;
+		
+		// Wait until block would have been captured live:
+		if( mRealtime ) {
+			if( mPosition == 0 )
+				mStartTime = std::chrono::steady_clock::now();
+			std::this_thread::sleep_until( mStartTime + std::chrono::microseconds( ( mPosition + mBlockFrames ) * 1000000 / mSampleRate ) );
+		}
+		
+		block->buffer    = NULL;
+		block->pcm       = mData + mPosition * mNumChannels;
+		block->numFrames = std::min( mBlockFrames, mNumFrames - mPosition );
+		block->droppedBlocks = 0;
+		block->droppedFrames = 0;
+		block->discontinuity = false;
+		mPosition += block->numFrames;
+		return true;
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,241 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Benchmark.hpp"
+#include "sphinx/Recognizer.hpp"
+#include "sphinx/ThreadPolicy.hpp"
+#include "sphinx/Tuner.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+namespace sphinx {
+	
+	//! decoder input block size (100 ms at 16 kHz), matching live streaming granularity
+	static const size_t kBenchmarkBlockSize = 1600;
+	
+	static double elapsedMs(const std::chrono::steady_clock::time_point& begin)
+	{
+		return std::chrono::duration<double,std::milli>( std::chrono::steady_clock::now() - begin ).count();
+	}
+	
+	void Benchmark::generateSpeechLike(double seconds, std::vector<int16_t>* output)
+	{
+		const double sampleRate = 16000.0;
+		const double twoPi = 6.283185307179586;
+		size_t count = size_t( seconds * sampleRate );
+		output->resize( count );
+		
+		// Deterministic noise so runs are comparable:
+		uint32_t seed = 0x2545F491u;
+		auto noise = [&seed]() { seed = seed * 1664525u + 1013904223u; return ( seed >> 8 ) / double( 1 << 24 ) - 0.5; };
+		
+		// Alternate 1.2 s of voiced syllables with 0.6 s of near-silence:
+		double phase = 0.0;
+		for(size_t i = 0; i < count; i++) {
+			double t = i / sampleRate;
+			double cycle = fmod( t, 1.8 );
+			double sample = 0.002 * noise();
+			if( cycle < 1.2 ) {
+				double envelope = 0.5 - 0.5 * cos( twoPi * 4.0 * cycle );
+				double f0 = 120.0 + 30.0 * sin( twoPi * 0.7 * t );
+				phase += twoPi * f0 / sampleRate;
+				
+				// Harmonics weighted toward first two formants, which drift per syllable:
+				double f1 = 500.0 + 250.0 * sin( twoPi * 1.3 * t );
+				double f2 = 1500.0 + 600.0 * sin( twoPi * 0.9 * t + 1.0 );
+				double voiced = 0.0;
+				for(int h = 1; h * f0 < 4000.0; h++) {
+					double f = h * f0;
+					double weight = exp( -pow( ( f - f1 ) / 200.0, 2.0 ) ) + 0.5 * exp( -pow( ( f - f2 ) / 300.0, 2.0 ) ) + 0.02;
+					voiced += weight * sin( h * phase );
+				}
+				sample += envelope * ( 0.15 * voiced + 0.01 * noise() );
+			}
+			( *output )[ i ] = int16_t( std::max( -1.0, std::min( 1.0, sample ) ) * 32767.0 );
+		}
+	}
+	
+	static double decodeStream(ps_decoder_t* decoder, const std::vector<int16_t>& audio, size_t uttSamples, double* finalizeMs)
+	{
+		double cpuTotal = 0.0, finalizeTotal = 0.0;
+		size_t numUtts = 0;
+		
+		for(size_t begin = 0; begin < audio.size(); begin += uttSamples) {
+			size_t end = std::min( audio.size(), begin + uttSamples );
+			if( ps_start_utt( decoder ) < 0 )
+				throw std::runtime_error( "Could not start utterance" );
+			
+			// Feed in live-sized blocks, timing this thread only since other streams decode concurrently:
+			double cpuBegin = ThreadPolicy::getThreadCpuSeconds();
+			for(size_t pos = begin; pos < end; pos += kBenchmarkBlockSize)
+				ps_process_raw( decoder, audio.data() + pos, std::min( kBenchmarkBlockSize, end - pos ), false, false );
+			
+			auto endBegin = std::chrono::steady_clock::now();
+			ps_end_utt( decoder );
+			ps_get_hyp( decoder, NULL );
+			finalizeTotal += elapsedMs( endBegin );
+			cpuTotal += ThreadPolicy::getThreadCpuSeconds() - cpuBegin;
+			numUtts++;
+		}
+		
+		if( finalizeMs )
+			*finalizeMs = numUtts > 0 ? finalizeTotal / numUtts : 0.0;
+		return cpuTotal;
+	}
+	
+	Benchmark::Benchmark(const RecognizerConfig& config, const std::string& jsgfData) :
+		mConfig( config ),
+		mJsgf( jsgfData ),
+		mUttSamples( 16000 * 5 )
+	{
+		for(size_t n = 1; n <= std::max( 1u, std::thread::hardware_concurrency() ); n *= 2)
+			mThreadCounts.push_back( n );
+		generate( 30.0 );
+	}
+	
+	Benchmark::Benchmark(const ci::fs::path& assetsPath) :
+		Benchmark( RecognizerConfig( assetsPath / "en-us", assetsPath / "cmudict-en-us.dict" ), "" )
+	{
+		ci::fs::path jsgfPath = assetsPath / "demo.jsgf";
+		std::ifstream fh( jsgfPath.c_str() );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load file: \"" + jsgfPath.string() + "\"" );
+		mJsgf.assign( ( std::istreambuf_iterator<char>( fh ) ), std::istreambuf_iterator<char>() );
+	}
+	
+	Benchmark& Benchmark::audio(const ci::fs::path& audioPath)
+	{
+		Tuner::loadAudio( audioPath, &mAudio );
+		if( mAudio.empty() )
+			throw std::runtime_error( "Could not load audio: \"" + audioPath.string() + "\" is empty" );
+		return *this;
+	}
+	
+	Benchmark& Benchmark::generate(double seconds)
+	{
+		generateSpeechLike( std::max( seconds, 0.1 ), &mAudio );
+		return *this;
+	}
+	
+	Benchmark::Result Benchmark::run() const
+	{
+		Result result;
+		result.audioSeconds = mAudio.size() / 16000.0;
+		
+		// Time decoder creation and grammar compilation separately:
+		auto loadBegin = std::chrono::steady_clock::now();
+		RecognizerRef recognizer = Recognizer::create( mConfig );
+		result.modelLoadMs = elapsedMs( loadBegin );
+		
+		auto grammarBegin = std::chrono::steady_clock::now();
+		recognizer->addModelJsgf( "benchmark", mJsgf, true );
+		result.grammarCompileMs = elapsedMs( grammarBegin );
+		
+		// Single stream:
+		auto singleBegin = std::chrono::steady_clock::now();
+		double cpu = decodeStream( recognizer->getDecoder(), mAudio, mUttSamples, &result.finalizeMs );
+		result.wallRtf = elapsedMs( singleBegin ) / 1000.0 / result.audioSeconds;
+		result.rtf = cpu / result.audioSeconds;
+		recognizer.reset();
+		
+		// Multiple streams, decoders created ahead of timing:
+		for( size_t count : mThreadCounts ) {
+			if( count == 0 )
+				continue;
+			
+			std::vector<RecognizerRef> recognizers;
+			for(size_t i = 0; i < count; i++) {
+				recognizers.push_back( Recognizer::create( mConfig ) );
+				recognizers.back()->addModelJsgf( "benchmark", mJsgf, true );
+			}
+			
+			std::vector<double> cpuTimes( count, 0.0 );
+			std::vector<std::thread> workers;
+			auto begin = std::chrono::steady_clock::now();
+			for(size_t i = 0; i < count; i++) {
+				workers.push_back( std::thread( [&, i]() {
+					cpuTimes[ i ] = decodeStream( recognizers[ i ]->getDecoder(), mAudio, mUttSamples, NULL );
+				} ) );
+			}
+			for( auto& w : workers )
+				w.join();
+			
+			Throughput t;
+			t.threads     = count;
+			t.wallSeconds = elapsedMs( begin ) / 1000.0;
+			t.audioPerSec = count * result.audioSeconds / t.wallSeconds;
+			t.rtf = 0.0;
+			for( double c : cpuTimes )
+				t.rtf += c / result.audioSeconds / count;
+			result.throughput.push_back( t );
+		}
+		
+		result.peakRssKb = getPeakRssKb();
+		return result;
+	}
+	
+	void Benchmark::writeReport(const Result& result, const ci::fs::path& jsonPath)
+	{
+		std::ofstream fh( jsonPath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not write benchmark report: \"" + jsonPath.string() + "\"" );
+		
+		fh << "{\n";
+		fh << "\t\"audio_seconds\": " << result.audioSeconds << ",\n";
+		fh << "\t\"model_load_ms\": " << result.modelLoadMs << ",\n";
+		fh << "\t\"grammar_compile_ms\": " << result.grammarCompileMs << ",\n";
+		fh << "\t\"rtf\": " << result.rtf << ",\n";
+		fh << "\t\"wall_rtf\": " << result.wallRtf << ",\n";
+		fh << "\t\"finalize_ms\": " << result.finalizeMs << ",\n";
+		fh << "\t\"throughput\": [";
+		for(size_t i = 0; i < result.throughput.size(); i++) {
+			const Throughput& t = result.throughput[ i ];
+			fh << ( i > 0 ? ",\n" : "\n" );
+			fh << "\t\t{ \"threads\": " << t.threads << ", \"wall_seconds\": " << t.wallSeconds
+			   << ", \"audio_per_sec\": " << t.audioPerSec << ", \"rtf\": " << t.rtf << " }";
+		}
+		fh << "\n\t],\n";
+		fh << "\t\"peak_rss_kb\": " << result.peakRssKb << "\n";
+		fh << "}\n";
+	}
+	
+	size_t Benchmark::getPeakRssKb()
+	{
+		struct rusage usage;
+		if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+			return 0;
+#if defined( __APPLE__ )
+		return size_t( usage.ru_maxrss ) / 1024;
+#else
+		return size_t( usage.ru_maxrss );
+#endif
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,349 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/CaptureQueue.hpp"
+#include "sphinx/Instrument.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+namespace sphinx {
+	
+	//! device callback instrument, compiled out unless built with SPHINX_INSTRUMENT
+	static InstrumentTimer<> sCaptureTimer( "capture" );
+	
+	//! no slot marker
+	static const size_t kNoSlot = size_t( -1 );
+	
+	//! reader wait bound, covering a wakeup lost because the producer signals without the mutex
+	static const std::chrono::milliseconds kReadWakeup( 2 );
+	
+	CaptureQueue::CaptureQueue(const Format& format) :
+		mFormat( format ),
+		mQueued( format.getCapacity() ),
+		mQueueHead( 0 ),
+		mQueueTail( 0 ),
+		mReturned( format.getCapacity() + 2 ),
+		mReturnTail( 0 ),
+		mReturnHead( 0 ),
+		mWriting( kNoSlot ),
+		mFill( 0 ),
+		mDiscarding( false ),
+		mNextSequence( 0 ),
+		mDiscarded( 0 ),
+		mDiscardedFrames( 0 ),
+		mResets( 0 ),
+		mHeld( kNoSlot ),
+		mReadSequence( 0 ),
+		mReadDiscarded( 0 ),
+		mReadDiscardedFrames( 0 ),
+		mReadResets( 0 ),
+		mClosed( false ),
+		mInterrupted( false ),
+		mDroppedBlocks( 0 ),
+		mDroppedFrames( 0 ),
+		mResetCount( 0 ),
+		mBlockedMicros( 0 ),
+		mMaxQueued( 0 )
+	{
+		// Queued blocks plus one held by the reader and one being filled:
+		size_t numSlots = format.getCapacity() + 2;
+		if( format.getSampleType() == SampleType::Float )
+			mFloatSlots.assign( numSlots, ci::audio::Buffer( format.getBlockFrames(), format.getNumChannels() ) );
+		else
+			mPcmSlots.assign( numSlots * format.getBlockFrames() * format.getNumChannels(), 0 );
+		mSlotFrames.assign( numSlots, 0 );
+		mSlotSequence.assign( numSlots, 0 );
+		mSlotDiscarded.assign( numSlots, 0 );
+		mSlotDiscardedFrames.assign( numSlots, 0 );
+		mSlotResets.assign( numSlots, 0 );
+		mFree.reserve( numSlots );
+		for(size_t i = numSlots; i > 0; i--)
+			mFree.push_back( i - 1 );
+	}
+	
+	bool CaptureQueue::dropOldest()
+	{
+		uint64_t head = mQueueHead.load( std::memory_order_acquire );
+		const uint64_t tail = mQueueTail.load( std::memory_order_relaxed );
+		while( head < tail ) {
+			size_t slot = mQueued[ head % mQueued.size() ].load( std::memory_order_relaxed );
+			if( mQueueHead.compare_exchange_weak( head, head + 1, std::memory_order_acq_rel ) ) {
+				// Reader learns of the loss from the gap in sequence numbers:
+				mFree.push_back( slot );
+				mDroppedBlocks.fetch_add( 1, std::memory_order_relaxed );
+				mDroppedFrames.fetch_add( mSlotFrames[ slot ], std::memory_order_relaxed );
+				return true;
+			}
+		}
+		return false;
+	}
+	
+	void CaptureQueue::beginBlock()
+	{
+		mFill = 0;
+		
+		if( queuedBlocks() >= mFormat.getCapacity() ) {
+			switch( mFormat.getOverflow() ) {
+				case Overflow::Block: {
+					auto begin = std::chrono::steady_clock::now();
+					{
+						std::unique_lock<std::mutex> lock( mMutex );
+						mWriteCv.wait( lock, [this]() { return queuedBlocks() < mFormat.getCapacity() || mInterrupted; } );
+					}
+					mBlockedMicros.fetch_add( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - begin ).count(), std::memory_order_relaxed );
+					if( mInterrupted ) {
+						mDiscarding = true;
+						return;
+					}
+					break;
+				}
+					
+				case Overflow::DropOldest:
+					dropOldest();
+					break;
+					
+				case Overflow::DropNewest:
+					mDiscarding = true;
+					return;
+					
+				case Overflow::SkipToLive:
+					while( dropOldest() )
+						continue;
+					mResets++;
+					mResetCount.fetch_add( 1, std::memory_order_relaxed );
+					break;
+			}
+		}
+		
+		// Collect slots released by the reader:
+		const uint64_t returnTail = mReturnTail.load( std::memory_order_acquire );
+		for(; mReturnHead < returnTail; mReturnHead++)
+			mFree.push_back( mReturned[ mReturnHead % mReturned.size() ].load( std::memory_order_relaxed ) );
+		
+		// Slot count covers a full queue, the held slot and this one, so this only guards against misuse:
+		if( mFree.empty() ) {
+			mDiscarding = true;
+			return;
+		}
+		mWriting = mFree.back();
+		mFree.pop_back();
+	}
+	
+	void CaptureQueue::endBlock()
+	{
+		if( mDiscarding ) {
+			mDiscarded++;
+			mDiscardedFrames += mFill;
+			mDroppedBlocks.fetch_add( 1, std::memory_order_relaxed );
+			mDroppedFrames.fetch_add( mFill, std::memory_order_relaxed );
+			mDiscarding = false;
+		}
+		else if( mWriting != kNoSlot ) {
+			mSlotFrames[ mWriting ]          = mFill;
+			mSlotSequence[ mWriting ]        = mNextSequence++;
+			mSlotDiscarded[ mWriting ]       = mDiscarded;
+			mSlotDiscardedFrames[ mWriting ] = mDiscardedFrames;
+			mSlotResets[ mWriting ]          = mResets;
+			
+			// Publish slot, releasing its contents to the reader:
+			uint64_t tail = mQueueTail.load( std::memory_order_relaxed );
+			mQueued[ tail % mQueued.size() ].store( mWriting, std::memory_order_relaxed );
+			mQueueTail.store( tail + 1, std::memory_order_release );
+			mWriting = kNoSlot;
+			
+			size_t queued = queuedBlocks();
+			if( queued > mMaxQueued.load( std::memory_order_relaxed ) )
+				mMaxQueued.store( queued, std::memory_order_relaxed );
+			mReadCv.notify_one();
+		}
+		mFill = 0;
+	}
+	
+	template<typename Fn>
+	void CaptureQueue::write(size_t numFrames, Fn fn)
+	{
+		const size_t blockFrames = mFormat.getBlockFrames();
+		
+		for(size_t pos = 0; pos < numFrames; ) {
+			if( mClosed.load( std::memory_order_relaxed ) )
+				return;
+			if( mWriting == kNoSlot && ! mDiscarding )
+				beginBlock();
+			
+			size_t count = std::min( blockFrames - mFill, numFrames - pos );
+			if( ! mDiscarding )
+				fn( mWriting, mFill, pos, count );
+			
+			mFill += count;
+			pos += count;
+			if( mFill == blockFrames )
+				endBlock();
+		}
+	}
+	
+	void CaptureQueue::push(const ci::audio::Buffer& buffer)
+	{
+		if( mFormat.getSampleType() != SampleType::Float )
+			throw std::runtime_error( "Could not push audio: capture queue holds int16 samples" );
+		
+		size_t numChannels = std::min( buffer.getNumChannels(), mFormat.getNumChannels() );
+		write( buffer.getNumFrames(), [&](size_t slot, size_t offset, size_t pos, size_t count) {
+			ci::audio::Buffer& dest = mFloatSlots[ slot ];
+			for(size_t ch = 0; ch < numChannels; ch++)
+				memcpy( dest.getChannel( ch ) + offset, buffer.getChannel( ch ) + pos, count * sizeof( float ) );
+		} );
+	}
+	
+	void CaptureQueue::push(const int16_t* data, size_t numFrames)
+	{
+		if( mFormat.getSampleType() != SampleType::Int16 )
+			throw std::runtime_error( "Could not push audio: capture queue holds float samples" );
+		
+		const size_t numChannels = mFormat.getNumChannels();
+		const size_t slotSize = mFormat.getBlockFrames() * numChannels;
+		write( numFrames, [&](size_t slot, size_t offset, size_t pos, size_t count) {
+			memcpy( mPcmSlots.data() + slot * slotSize + offset * numChannels, data + pos * numChannels, count * numChannels * sizeof( int16_t ) );
+		} );
+	}
+	
+	void CaptureQueue::close()
+	{
+		if( mClosed )
+			return;
+		
+		// Pad partial float block, whose buffer is read whole:
+		if( mWriting != kNoSlot && mFill > 0 && mFormat.getSampleType() == SampleType::Float ) {
+			ci::audio::Buffer& dest = mFloatSlots[ mWriting ];
+			for(size_t ch = 0; ch < dest.getNumChannels(); ch++)
+				std::fill( dest.getChannel( ch ) + mFill, dest.getChannel( ch ) + dest.getNumFrames(), 0.0f );
+			mFill = dest.getNumFrames();
+		}
+		if( mFill > 0 )
+			endBlock();
+		
+		std::lock_guard<std::mutex> lock( mMutex );
+		mClosed = true;
+		mReadCv.notify_all();
+	}
+	
+	void CaptureQueue::interrupt()
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mInterrupted = true;
+		mReadCv.notify_all();
+		mWriteCv.notify_all();
+	}
+	
+	bool CaptureQueue::read(Block* block)
+	{
+		// Release previous block to the producer:
+		if( mHeld != kNoSlot ) {
+			uint64_t returnTail = mReturnTail.load( std::memory_order_relaxed );
+			mReturned[ returnTail % mReturned.size() ].store( mHeld, std::memory_order_relaxed );
+			mReturnTail.store( returnTail + 1, std::memory_order_release );
+			mHeld = kNoSlot;
+		}
+		
+		while( mHeld == kNoSlot ) {
+			if( mInterrupted )
+				return false;
+			
+			// Pop oldest, racing only a producer dropping it:
+			uint64_t head = mQueueHead.load( std::memory_order_acquire );
+			while( head < mQueueTail.load( std::memory_order_acquire ) ) {
+				size_t slot = mQueued[ head % mQueued.size() ].load( std::memory_order_relaxed );
+				if( mQueueHead.compare_exchange_weak( head, head + 1, std::memory_order_acq_rel ) ) {
+					mHeld = slot;
+					break;
+				}
+			}
+			if( mHeld != kNoSlot )
+				break;
+			
+			// Closed flag is set after the last block is queued, so an empty queue seen afterwards stays empty:
+			if( mClosed && queuedBlocks() == 0 )
+				return false;
+			
+			std::unique_lock<std::mutex> lock( mMutex );
+			mReadCv.wait_for( lock, kReadWakeup, [this]() { return queuedBlocks() > 0 || mClosed || mInterrupted; } );
+		}
+		
+		if( mFormat.getOverflow() == Overflow::Block ) {
+			// Producer checks for space under the mutex, so taking it here cannot miss a waiter:
+			{ std::lock_guard<std::mutex> lock( mMutex ); }
+			mWriteCv.notify_one();
+		}
+		
+		// Blocks missing from the sequence were dropped oldest, the rest were discarded on arrival:
+		uint64_t dropped = mSlotSequence[ mHeld ] - mReadSequence;
+		uint64_t discarded = mSlotDiscarded[ mHeld ] - mReadDiscarded;
+		uint64_t discardedFrames = mSlotDiscardedFrames[ mHeld ] - mReadDiscardedFrames;
+		bool discontinuity = mSlotResets[ mHeld ] != mReadResets;
+		mReadSequence = mSlotSequence[ mHeld ] + 1;
+		mReadDiscarded = mSlotDiscarded[ mHeld ];
+		mReadDiscardedFrames = mSlotDiscardedFrames[ mHeld ];
+		mReadResets = mSlotResets[ mHeld ];
+		
+		bool isFloat = mFormat.getSampleType() == SampleType::Float;
+		block->buffer        = isFloat ? &mFloatSlots[ mHeld ] : NULL;
+		block->pcm           = isFloat ? NULL : mPcmSlots.data() + mHeld * mFormat.getBlockFrames() * mFormat.getNumChannels();
+		block->numFrames     = mSlotFrames[ mHeld ];
+		block->droppedBlocks = size_t( dropped + discarded );
+		block->droppedFrames = size_t( dropped * mFormat.getBlockFrames() + discardedFrames );
+		block->discontinuity = discontinuity;
+		return true;
+	}
+	
+	size_t CaptureQueue::getQueuedFrames() const
+	{
+		return queuedBlocks() * mFormat.getBlockFrames();
+	}
+	
+	CaptureQueue::Metrics CaptureQueue::getMetrics() const
+	{
+		Metrics metrics;
+		metrics.droppedBlocks   = mDroppedBlocks.load( std::memory_order_relaxed );
+		metrics.droppedFrames   = mDroppedFrames.load( std::memory_order_relaxed );
+		metrics.resets          = mResetCount.load( std::memory_order_relaxed );
+		metrics.blockedSeconds  = mBlockedMicros.load( std::memory_order_relaxed ) / 1.0e6;
+		metrics.queuedBlocks    = queuedBlocks();
+		metrics.maxQueuedBlocks = mMaxQueued.load( std::memory_order_relaxed );
+		return metrics;
+	}
+	
+	size_t CaptureQueue::getStorageBytes() const
+	{
+		size_t sampleBytes = mFormat.getSampleType() == SampleType::Float ? sizeof( float ) : sizeof( int16_t );
+		return ( mFormat.getCapacity() + 2 ) * mFormat.getBlockFrames() * mFormat.getNumChannels() * sampleBytes;
+	}
+	
+	void CaptureNode::process(ci::audio::Buffer* buffer)
+	{
+		SPHINX_TIMED_SCOPE( sCaptureTimer );
+		mQueue->push( *buffer );
+	}
+	
+} // namespace sphinx
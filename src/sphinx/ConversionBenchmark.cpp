@@ -0,0 +1,188 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/ConversionBenchmark.hpp"
+#include "sphinx/AudioConvert.hpp"
+#include "sphinx/AllocationCounter.hpp"
+#include "sphinx/Resampler.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "cinder/audio/dsp/Converter.h"
+
+namespace sphinx {
+	
+	/** @brief existing recognizer path: generic converter and per-block int16 allocation */
+	class KernelConverter : public ConversionBenchmark::Kernel
+	{
+	  private:
+		
+		std::unique_ptr<ci::audio::dsp::Converter>	mConverter;
+		ci::audio::Buffer							mDestBuffer;
+		bool										mReuse;
+		std::vector<int16_t>						mData;
+		
+	  public:
+		
+		KernelConverter(size_t sampleRate, size_t numChannels, size_t blockSize, bool reuse) :
+			mConverter( ci::audio::dsp::Converter::create( sampleRate, 16000, numChannels, 1, blockSize ) ),
+			mDestBuffer( mConverter->getDestMaxFramesPerBlock(), mConverter->getDestNumChannels() ),
+			mReuse( reuse ),
+			mData( reuse ? mConverter->getDestMaxFramesPerBlock() : 0 )
+		{
+			/* no-op */
+		}
+		
+		void process(const ci::audio::Buffer& input)
+		{
+			std::pair<size_t,size_t> convertResult = mConverter->convert( &input, &mDestBuffer );
+			if( mReuse ) {
+				convertFloatToInt16( mDestBuffer.getData(), mData.data(), convertResult.second );
+			}
+			else {
+				int16_t* data = new int16_t[ convertResult.second ];
+				convertFloatToInt16( mDestBuffer.getData(), data, convertResult.second );
+				delete[] data;
+			}
+		}
+	};
+	
+	/** @brief recognizer resampler, polyphase for integer ratios */
+	class KernelResampler : public ConversionBenchmark::Kernel
+	{
+	  private:
+		
+		ResamplerRef			mResampler;
+		std::vector<int16_t>	mData;
+		
+	  public:
+		
+		KernelResampler(size_t sampleRate, size_t numChannels, size_t blockSize) :
+			mResampler( Resampler::create( sampleRate, numChannels, blockSize ) ),
+			mData( mResampler->getMaxOutputFrames() )
+		{
+			/* no-op */
+		}
+		
+		void process(const ci::audio::Buffer& input)
+		{
+			mResampler->process( input, mData.data() );
+		}
+	};
+	
+	ConversionBenchmark::ConversionBenchmark() :
+		mBlockSizes( { 256, 512, 1024, 2048, 4096 } ),
+		mSampleRates( { 44100, 48000, 96000 } ),
+		mNumChannels( 1 ),
+		mSeconds( 10.0 )
+	{
+		add( "converter", [](size_t sampleRate, size_t numChannels, size_t blockSize) {
+			return KernelRef( new KernelConverter( sampleRate, numChannels, blockSize, false ) );
+		} );
+		add( "converter-reuse", [](size_t sampleRate, size_t numChannels, size_t blockSize) {
+			return KernelRef( new KernelConverter( sampleRate, numChannels, blockSize, true ) );
+		} );
+		add( "resampler", [](size_t sampleRate, size_t numChannels, size_t blockSize) {
+			return KernelRef( new KernelResampler( sampleRate, numChannels, blockSize ) );
+		} );
+	}
+	
+	ConversionBenchmark& ConversionBenchmark::add(const std::string& name, const KernelFactory& factory)
+	{
+		mKernels.push_back( std::make_pair( name, factory ) );
+		return *this;
+	}
+	
+	std::vector<ConversionBenchmark::Result> ConversionBenchmark::run() const
+	{
+		std::vector<Result> results;
+		
+		for( size_t sampleRate : mSampleRates ) {
+			for( size_t blockSize : mBlockSizes ) {
+				// Fill block with tone and deterministic noise, non-interleaved like Cinder buffers:
+				ci::audio::Buffer input( blockSize, mNumChannels );
+				uint32_t seed = 0x2545F491u;
+				for(size_t ch = 0; ch < mNumChannels; ch++) {
+					float* channel = input.getChannel( ch );
+					for(size_t i = 0; i < blockSize; i++) {
+						seed = seed * 1664525u + 1013904223u;
+						channel[ i ] = 0.5f * float( sin( 6.283185307179586 * 440.0 * i / sampleRate ) ) + ( ( seed >> 8 ) / float( 1 << 24 ) - 0.5f ) * 0.1f;
+					}
+				}
+				
+				size_t numBlocks = std::max<size_t>( 1, size_t( mSeconds * sampleRate / blockSize ) );
+				
+				for( const auto& entry : mKernels ) {
+					KernelRef kernel = entry.second( sampleRate, mNumChannels, blockSize );
+					
+					// Warm up filter state and caches:
+					for(size_t i = 0; i < 16; i++)
+						kernel->process( input );
+					
+					uint64_t allocsBegin = AllocationCounter::getThreadCount();
+					uint64_t bytesBegin  = AllocationCounter::getThreadBytes();
+					auto begin = std::chrono::steady_clock::now();
+					for(size_t i = 0; i < numBlocks; i++)
+						kernel->process( input );
+					std::chrono::duration<double,std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+					
+					Result r;
+					r.kernel         = entry.first;
+					r.sampleRate     = sampleRate;
+					r.numChannels    = mNumChannels;
+					r.blockSize      = blockSize;
+					r.nsPerSample    = elapsed.count() / double( numBlocks * blockSize );
+					r.allocsPerBlock = double( AllocationCounter::getThreadCount() - allocsBegin ) / numBlocks;
+					r.bytesPerBlock  = double( AllocationCounter::getThreadBytes() - bytesBegin ) / numBlocks;
+					results.push_back( r );
+				}
+			}
+		}
+		
+		return results;
+	}
+	
+	void ConversionBenchmark::writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath)
+	{
+		std::ofstream fh( csvPath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not write conversion benchmark report: \"" + csvPath.string() + "\"" );
+		
+		bool counted = AllocationCounter::isEnabled();
+		fh << "kernel,sample_rate,channels,block_size,ns_per_sample,allocs_per_block,bytes_per_block\n";
+		for( const auto& r : results ) {
+			fh << r.kernel << "," << r.sampleRate << "," << r.numChannels << "," << r.blockSize << "," << r.nsPerSample << ",";
+			if( counted )
+				fh << r.allocsPerBlock << "," << r.bytesPerBlock;
+			else
+				fh << ",";
+			fh << "\n";
+		}
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,403 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Dictionary.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace sphinx {
+	
+	static const char		kCacheMagic[ 4 ]	= { 'S', 'P', 'X', 'D' };
+	static const uint32_t	kCacheVersion		= 1;
+	static const uint32_t	kEmptySlot			= 0xFFFFFFFF;
+	static const uint32_t	kMaxDisplacement	= 1 << 24;
+	
+	struct Dictionary::Header
+	{
+		char		magic[ 4 ];
+		uint32_t	version;
+		uint32_t	imageSize;
+		uint32_t	numEntries;
+		uint32_t	numSlots;
+		uint32_t	numBuckets;
+		uint32_t	numNames;
+		uint32_t	displaceOffset;
+		uint32_t	slotsOffset;
+		uint32_t	namesOffset;
+		uint32_t	wordsOffset;
+		uint32_t	phonesOffset;
+	};
+	
+	struct Dictionary::Slot
+	{
+		uint32_t	word;			//!< offset into word pool, or kEmptySlot
+		uint32_t	phones;			//!< offset into phone pool
+		uint16_t	wordLength;		//!< word length in bytes
+		uint16_t	phoneCount;		//!< number of phones
+	};
+	
+	static uint32_t hashWord(const char* word, size_t length, uint32_t seed)
+	{
+		// FNV-1a with seed folded into offset basis:
+		uint32_t h = 2166136261u ^ ( seed * 0x9E3779B9u );
+		for(size_t i = 0; i < length; i++) {
+			h ^= uint8_t( word[ i ] );
+			h *= 16777619u;
+		}
+		return h ^ ( h >> 15 );
+	}
+	
+	static uint32_t alignSize(uint32_t size)
+	{
+		return ( size + 3 ) & ~uint32_t( 3 );
+	}
+	
+	size_t Pronunciation::format(char* output, size_t outputSize) const
+	{
+		size_t length = 0;
+		
+		for(size_t i = 0; i < mSize; i++) {
+			const char* name = (*this)[ i ];
+			size_t nameLength = strlen( name );
+			// Require room for separator, name and terminator:
+			if( length + ( i > 0 ? 1 : 0 ) + nameLength + 1 > outputSize )
+				return 0;
+			if( i > 0 )
+				output[ length++ ] = ' ';
+			memcpy( output + length, name, nameLength );
+			length += nameLength;
+		}
+		
+		if( length >= outputSize )
+			return 0;
+		
+		output[ length ] = '\0';
+		return length;
+	}
+	
+	Dictionary::Dictionary() :
+		mMapped( NULL ),
+		mHeader( NULL ),
+		mDisplace( NULL ),
+		mSlots( NULL ),
+		mNames( NULL ),
+		mWords( NULL ),
+		mPhones( NULL )
+	{
+		/* no-op */
+	}
+	
+	Dictionary::~Dictionary()
+	{
+		if( mMapped ) mmio_file_unmap( mMapped );
+	}
+	
+	bool Dictionary::isCache(const ci::fs::path& path)
+	{
+		char magic[ 4 ];
+		std::ifstream fh( path.c_str(), std::ios::binary );
+		return fh.read( magic, sizeof( magic ) ) && memcmp( magic, kCacheMagic, sizeof( magic ) ) == 0;
+	}
+	
+	void Dictionary::writeCache(const ci::fs::path& dictPath, const ci::fs::path& cachePath)
+	{
+		Dictionary dict;
+		dict.loadText( dictPath );
+		dict.save( cachePath );
+	}
+	
+	void Dictionary::loadText(const ci::fs::path& dictPath, const std::unordered_set<std::string>* vocabulary)
+	{
+		std::ifstream fh( dictPath.c_str() );
+		
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load dictionary: \"" + dictPath.string() + "\"" );
+		
+		std::vector<std::string>				words;
+		std::vector<std::vector<uint8_t> >		prons;
+		std::vector<std::string>				names;
+		std::unordered_map<std::string,uint8_t>	nameMap;
+		std::unordered_set<std::string>			seen;
+		
+		std::string line, baseWord;
+		
+		// An empty vocabulary needs no scan:
+		bool scan = ! vocabulary || ! vocabulary->empty();
+		
+		while( scan && std::getline( fh, line ) ) {
+			// Split entry into word and phone string:
+			size_t wordEnd = line.find_first_of( " \t" );
+			if( wordEnd == std::string::npos || wordEnd == 0 || line[ 0 ] == '#' )
+				continue;
+			
+			// Skip words outside vocabulary before parsing phones, alternates "word(n)" follow their base word:
+			if( vocabulary ) {
+				size_t baseEnd = wordEnd;
+				if( line[ wordEnd - 1 ] == ')' ) {
+					size_t open = line.rfind( '(', wordEnd - 1 );
+					if( open != std::string::npos && open > 0 )
+						baseEnd = open;
+				}
+				baseWord.assign( line, 0, baseEnd );
+				if( vocabulary->count( baseWord ) == 0 )
+					continue;
+			}
+			
+			std::string word = line.substr( 0, wordEnd );
+			// Keep first entry of duplicated words:
+			if( ! seen.insert( word ).second )
+				continue;
+			
+			std::vector<uint8_t> pron;
+			size_t pos = wordEnd;
+			while( ( pos = line.find_first_not_of( " \t\r", pos ) ) != std::string::npos && line[ pos ] != '#' ) {
+				size_t end = line.find_first_of( " \t\r", pos );
+				std::string name = line.substr( pos, end == std::string::npos ? std::string::npos : end - pos );
+				pos = end;
+				// Intern phone name:
+				auto findName = nameMap.find( name );
+				if( findName == nameMap.end() ) {
+					if( names.size() > 255 || name.size() >= Pronunciation::kPhoneNameSize )
+						throw std::runtime_error( "Could not index phone \"" + name + "\" in dictionary" );
+					findName = nameMap.emplace( name, uint8_t( names.size() ) ).first;
+					names.push_back( name );
+				}
+				pron.push_back( findName->second );
+			}
+			
+			if( pron.empty() || word.size() > 0xFFFF || pron.size() > 0xFFFF )
+				continue;
+			
+			words.push_back( word );
+			prons.push_back( pron );
+		}
+		
+		const uint32_t numEntries = uint32_t( words.size() );
+		const uint32_t numSlots   = numEntries + numEntries / 8 + 1;
+		const uint32_t numBuckets = numEntries / 4 + 1;
+		
+		// Distribute entries into buckets:
+		std::vector<std::vector<uint32_t> > buckets( numBuckets );
+		for(uint32_t i = 0; i < numEntries; i++)
+			buckets[ hashWord( words[ i ].data(), words[ i ].size(), 0 ) % numBuckets ].push_back( i );
+		
+		std::vector<uint32_t> order( numBuckets );
+		for(uint32_t i = 0; i < numBuckets; i++)
+			order[ i ] = i;
+		std::sort( order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[ a ].size() > buckets[ b ].size(); } );
+		
+		// Find displacement for each bucket, largest first, such that its entries land in distinct free slots:
+		std::vector<uint32_t> displace( numBuckets, 0 );
+		std::vector<uint32_t> slotEntry( numSlots, kEmptySlot );
+		std::vector<uint32_t> candidate;
+		
+		for( uint32_t b : order ) {
+			const std::vector<uint32_t>& bucket = buckets[ b ];
+			if( bucket.empty() )
+				break;
+			
+			uint32_t d = 1;
+			for( ; d < kMaxDisplacement; d++ ) {
+				candidate.clear();
+				bool valid = true;
+				for( uint32_t e : bucket ) {
+					uint32_t s = hashWord( words[ e ].data(), words[ e ].size(), d ) % numSlots;
+					if( slotEntry[ s ] != kEmptySlot || std::find( candidate.begin(), candidate.end(), s ) != candidate.end() ) {
+						valid = false;
+						break;
+					}
+					candidate.push_back( s );
+				}
+				if( valid )
+					break;
+			}
+			
+			if( d == kMaxDisplacement )
+				throw std::runtime_error( "Could not build dictionary index: \"" + dictPath.string() + "\"" );
+			
+			displace[ b ] = d;
+			for(size_t i = 0; i < bucket.size(); i++)
+				slotEntry[ candidate[ i ] ] = bucket[ i ];
+		}
+		
+		// Lay out image sections:
+		uint32_t wordsSize = 0, phonesSize = 0;
+		for(uint32_t i = 0; i < numEntries; i++) {
+			wordsSize  += uint32_t( words[ i ].size() );
+			phonesSize += uint32_t( prons[ i ].size() );
+		}
+		
+		Header header;
+		memcpy( header.magic, kCacheMagic, sizeof( kCacheMagic ) );
+		header.version			= kCacheVersion;
+		header.numEntries		= numEntries;
+		header.numSlots			= numSlots;
+		header.numBuckets		= numBuckets;
+		header.numNames			= uint32_t( names.size() );
+		header.displaceOffset	= alignSize( sizeof( Header ) );
+		header.slotsOffset		= header.displaceOffset + alignSize( numBuckets * sizeof( uint32_t ) );
+		header.namesOffset		= header.slotsOffset + alignSize( numSlots * sizeof( Slot ) );
+		header.wordsOffset		= header.namesOffset + alignSize( uint32_t( names.size() * Pronunciation::kPhoneNameSize ) );
+		header.phonesOffset		= header.wordsOffset + alignSize( wordsSize );
+		header.imageSize		= header.phonesOffset + alignSize( phonesSize );
+		
+		mImage.assign( header.imageSize / sizeof( uint32_t ), 0 );
+		char* image = reinterpret_cast<char*>( mImage.data() );
+		
+		memcpy( image, &header, sizeof( header ) );
+		memcpy( image + header.displaceOffset, displace.data(), numBuckets * sizeof( uint32_t ) );
+		
+		for(size_t i = 0; i < names.size(); i++)
+			memcpy( image + header.namesOffset + i * Pronunciation::kPhoneNameSize, names[ i ].c_str(), names[ i ].size() + 1 );
+		
+		// Pack strings in slot order:
+		Slot* slots = reinterpret_cast<Slot*>( image + header.slotsOffset );
+		uint32_t wordPos = 0, phonePos = 0;
+		for(uint32_t s = 0; s < numSlots; s++) {
+			uint32_t e = slotEntry[ s ];
+			if( e == kEmptySlot ) {
+				slots[ s ].word = kEmptySlot;
+				continue;
+			}
+			slots[ s ].word			= wordPos;
+			slots[ s ].phones		= phonePos;
+			slots[ s ].wordLength	= uint16_t( words[ e ].size() );
+			slots[ s ].phoneCount	= uint16_t( prons[ e ].size() );
+			memcpy( image + header.wordsOffset + wordPos, words[ e ].data(), words[ e ].size() );
+			memcpy( image + header.phonesOffset + phonePos, prons[ e ].data(), prons[ e ].size() );
+			wordPos  += uint32_t( words[ e ].size() );
+			phonePos += uint32_t( prons[ e ].size() );
+		}
+		
+		bind( image, header.imageSize );
+	}
+	
+	void Dictionary::loadCache(const ci::fs::path& cachePath)
+	{
+		std::ifstream fh( cachePath.c_str(), std::ios::binary | std::ios::ate );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load dictionary cache: \"" + cachePath.string() + "\"" );
+		size_t fileSize = size_t( fh.tellg() );
+		fh.close();
+		
+		mMapped = mmio_file_read( cachePath.c_str() );
+		if( mMapped == NULL )
+			throw std::runtime_error( "Could not map dictionary cache: \"" + cachePath.string() + "\"" );
+		
+		bind( mmio_file_ptr( mMapped ), fileSize );
+	}
+	
+	void Dictionary::bind(const void* image, size_t imageSize)
+	{
+		const char* base = static_cast<const char*>( image );
+		const Header* header = static_cast<const Header*>( image );
+		
+		if( imageSize < sizeof( Header ) || memcmp( header->magic, kCacheMagic, sizeof( kCacheMagic ) ) != 0 || header->version != kCacheVersion )
+			throw std::runtime_error( "Could not read dictionary cache: unsupported format" );
+		
+		if( header->imageSize > imageSize || header->numBuckets == 0 || header->numSlots == 0
+		   || header->displaceOffset + uint64_t( header->numBuckets ) * sizeof( uint32_t ) > header->slotsOffset
+		   || header->slotsOffset + uint64_t( header->numSlots ) * sizeof( Slot ) > header->namesOffset
+		   || header->namesOffset + uint64_t( header->numNames ) * Pronunciation::kPhoneNameSize > header->wordsOffset
+		   || header->wordsOffset > header->phonesOffset || header->phonesOffset > header->imageSize )
+			throw std::runtime_error( "Could not read dictionary cache: truncated or corrupt image" );
+		
+		// Phone names must be terminated within their stride:
+		const char* names = base + header->namesOffset;
+		for(uint32_t i = 0; i < header->numNames; i++) {
+			if( memchr( names + i * Pronunciation::kPhoneNameSize, '\0', Pronunciation::kPhoneNameSize ) == NULL )
+				throw std::runtime_error( "Could not read dictionary cache: corrupt phone table" );
+		}
+		
+		// Every occupied slot must reference its own pools and known phones, so lookups need no checks:
+		const Slot* slots = reinterpret_cast<const Slot*>( base + header->slotsOffset );
+		const uint8_t* phones = reinterpret_cast<const uint8_t*>( base + header->phonesOffset );
+		const uint64_t wordsSize = header->phonesOffset - header->wordsOffset;
+		const uint64_t phonesSize = header->imageSize - header->phonesOffset;
+		uint32_t occupied = 0;
+		for(uint32_t s = 0; s < header->numSlots; s++) {
+			const Slot& slot = slots[ s ];
+			if( slot.word == kEmptySlot )
+				continue;
+			if( uint64_t( slot.word ) + slot.wordLength > wordsSize || uint64_t( slot.phones ) + slot.phoneCount > phonesSize )
+				throw std::runtime_error( "Could not read dictionary cache: corrupt entry" );
+			for(uint32_t p = 0; p < slot.phoneCount; p++) {
+				if( phones[ slot.phones + p ] >= header->numNames )
+					throw std::runtime_error( "Could not read dictionary cache: corrupt entry" );
+			}
+			occupied++;
+		}
+		if( occupied != header->numEntries )
+			throw std::runtime_error( "Could not read dictionary cache: corrupt index" );
+		
+		mHeader		= header;
+		mDisplace	= reinterpret_cast<const uint32_t*>( base + header->displaceOffset );
+		mSlots		= reinterpret_cast<const Slot*>( base + header->slotsOffset );
+		mNames		= base + header->namesOffset;
+		mWords		= base + header->wordsOffset;
+		mPhones		= reinterpret_cast<const uint8_t*>( base + header->phonesOffset );
+	}
+	
+	size_t Dictionary::size() const
+	{
+		return mHeader ? mHeader->numEntries : 0;
+	}
+	
+	size_t Dictionary::getImageSize() const
+	{
+		return mHeader ? mHeader->imageSize : 0;
+	}
+	
+	bool Dictionary::lookup(const char* word, size_t length, Pronunciation* output) const
+	{
+		if( mHeader == NULL || mHeader->numEntries == 0 )
+			return false;
+		
+		uint32_t bucket = hashWord( word, length, 0 ) % mHeader->numBuckets;
+		const Slot& slot = mSlots[ hashWord( word, length, mDisplace[ bucket ] ) % mHeader->numSlots ];
+		
+		// Displaced hash is only perfect for known words, so verify key:
+		if( slot.word == kEmptySlot || slot.wordLength != length || memcmp( mWords + slot.word, word, length ) != 0 )
+			return false;
+		
+		if( output )
+			*output = Pronunciation( mPhones + slot.phones, slot.phoneCount, mNames );
+		
+		return true;
+	}
+	
+	void Dictionary::save(const ci::fs::path& cachePath) const
+	{
+		std::ofstream fh( cachePath.c_str(), std::ios::binary | std::ios::trunc );
+		
+		if( ! fh.is_open() || mHeader == NULL || ! fh.write( reinterpret_cast<const char*>( mHeader ), mHeader->imageSize ) )
+			throw std::runtime_error( "Could not write dictionary cache: \"" + cachePath.string() + "\"" );
+	}
+	
+} // namespace sphinx
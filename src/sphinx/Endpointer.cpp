@@ -0,0 +1,82 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Endpointer.hpp"
+
+namespace sphinx {
+	
+	void Endpointer::setFormat(const Format& format)
+	{
+		mMinSpeechSamples	= format.getMinSpeech() * format.getSampleRate() / 1000;
+		mHangoverSamples	= format.getHangover() * format.getSampleRate() / 1000;
+		mMaxUttSamples		= format.getMaxUtterance() * format.getSampleRate() / 1000;
+		reset();
+	}
+	
+	void Endpointer::reset()
+	{
+		mInUtterance	= false;
+		mSpeechSamples	= 0;
+		mSilenceSamples	= 0;
+		mUttSamples		= 0;
+	}
+	
+	Endpointer::Event Endpointer::update(bool inSpeech, size_t numSamples)
+	{
+		if( ! mInUtterance ) {
+			if( ! inSpeech )
+				return Event::None;
+			mInUtterance = true;
+			mSpeechSamples = numSamples;
+			mSilenceSamples = 0;
+			mUttSamples = numSamples;
+			return Event::Start;
+		}
+		
+		mUttSamples += numSamples;
+		
+		if( inSpeech ) {
+			mSpeechSamples += numSamples;
+			mSilenceSamples = 0;
+		}
+		else {
+			mSilenceSamples += numSamples;
+		}
+		
+		// Force cut bounds decoder memory and result latency when VAD never returns to silence:
+		if( mMaxUttSamples > 0 && mUttSamples >= mMaxUttSamples ) {
+			reset();
+			return Event::Cut;
+		}
+		
+		if( ! inSpeech && mSilenceSamples >= mHangoverSamples ) {
+			bool enoughSpeech = mSpeechSamples >= mMinSpeechSamples;
+			reset();
+			return enoughSpeech ? Event::End : Event::Discard;
+		}
+		
+		return Event::None;
+	}
+	
+} // namespace sphinx
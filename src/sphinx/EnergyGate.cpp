@@ -0,0 +1,152 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/EnergyGate.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+	#include <emmintrin.h>
+	#define SPHINX_ENERGYGATE_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+	#include <arm_neon.h>
+	#define SPHINX_ENERGYGATE_NEON
+#endif
+
+namespace sphinx {
+	
+	/** @brief computes RMS level and zero crossings of block in a single pass, four samples at a time where SIMD is available */
+	static void measure(const float* data, size_t size, float* level, size_t* crossings)
+	{
+		float energy = data[ 0 ] * data[ 0 ];
+		size_t count = 0;
+		size_t i = 1;
+		
+		// Each lane compares a sample's sign with its predecessor's, sign masks are all ones so subtracting counts them:
+#if defined( SPHINX_ENERGYGATE_SSE )
+		const __m128 zero = _mm_setzero_ps();
+		__m128 acc = _mm_setzero_ps();
+		__m128i signChanges = _mm_setzero_si128();
+		for(; i + 4 <= size; i += 4) {
+			__m128 prev = _mm_loadu_ps( data + i - 1 );
+			__m128 cur = _mm_loadu_ps( data + i );
+			acc = _mm_add_ps( acc, _mm_mul_ps( cur, cur ) );
+			__m128 change = _mm_xor_ps( _mm_cmplt_ps( prev, zero ), _mm_cmplt_ps( cur, zero ) );
+			signChanges = _mm_sub_epi32( signChanges, _mm_castps_si128( change ) );
+		}
+		alignas( 16 ) float accLanes[ 4 ];
+		alignas( 16 ) int32_t changeLanes[ 4 ];
+		_mm_store_ps( accLanes, acc );
+		_mm_store_si128( reinterpret_cast<__m128i*>( changeLanes ), signChanges );
+		energy += ( accLanes[ 0 ] + accLanes[ 1 ] ) + ( accLanes[ 2 ] + accLanes[ 3 ] );
+		count += size_t( changeLanes[ 0 ] ) + size_t( changeLanes[ 1 ] ) + size_t( changeLanes[ 2 ] ) + size_t( changeLanes[ 3 ] );
+#elif defined( SPHINX_ENERGYGATE_NEON )
+		const float32x4_t zero = vdupq_n_f32( 0.0f );
+		float32x4_t acc = vdupq_n_f32( 0.0f );
+		uint32x4_t signChanges = vdupq_n_u32( 0 );
+		for(; i + 4 <= size; i += 4) {
+			float32x4_t prev = vld1q_f32( data + i - 1 );
+			float32x4_t cur = vld1q_f32( data + i );
+			acc = vmlaq_f32( acc, cur, cur );
+			signChanges = vsubq_u32( signChanges, veorq_u32( vcltq_f32( prev, zero ), vcltq_f32( cur, zero ) ) );
+		}
+		float32x2_t sum = vadd_f32( vget_low_f32( acc ), vget_high_f32( acc ) );
+		energy += vget_lane_f32( vpadd_f32( sum, sum ), 0 );
+		uint32x2_t changes = vadd_u32( vget_low_u32( signChanges ), vget_high_u32( signChanges ) );
+		count += vget_lane_u32( vpadd_u32( changes, changes ), 0 );
+#endif
+		
+		// Remainder, or whole block without SIMD:
+		for(; i < size; i++) {
+			energy += data[ i ] * data[ i ];
+			count += ( data[ i - 1 ] < 0.0f ) != ( data[ i ] < 0.0f );
+		}
+		
+		*level = std::sqrt( energy / size );
+		*crossings = count;
+	}
+	
+	EnergyGate::EnergyGate(const Format& format) :
+		mFormat( format ),
+		mHangoverSamples( format.getHangover() * format.getSampleRate() / 1000 ),
+		mQuietSamples( 0 ),
+		mFloorValid( false ),
+		mOpen( false ),
+		mFloor( 0.0f ),
+		mGated( 0 ),
+		mPassed( 0 )
+	{
+		/* no-op */
+	}
+	
+	bool EnergyGate::update(const float* data, size_t size)
+	{
+		if( size == 0 )
+			return mOpen;
+		
+		float level;
+		size_t crossings;
+		measure( data, size, &level, &crossings );
+		float zcr = float( crossings ) / size;
+		
+		if( ! mFloorValid ) {
+			mFloor = std::max( level, mFormat.getMinLevel() );
+			mFloorValid = true;
+		}
+		
+		float floor = mFloor;
+		bool loud = level > std::max( floor * mFormat.getOpenRatio(), mFormat.getMinLevel() );
+		bool fricative = zcr > mFormat.getZcrThreshold() && level > std::max( floor * mFormat.getFricativeRatio(), mFormat.getMinLevel() );
+		
+		if( loud || fricative ) {
+			mOpen = true;
+			mQuietSamples = 0;
+		}
+		else if( mOpen ) {
+			mQuietSamples += size;
+			if( mQuietSamples >= mHangoverSamples )
+				mOpen = false;
+		}
+		
+		// Floor drops immediately and rises slowly, more slowly still while gate is open:
+		if( level < floor )
+			mFloor = std::max( level, mFormat.getMinLevel() * 0.1f );
+		else
+			mFloor = floor + ( level - floor ) * mFormat.getFloorRise() * ( mOpen ? 0.1f : 1.0f );
+		
+		return mOpen;
+	}
+	
+	EnergyGate::Metrics EnergyGate::getMetrics() const
+	{
+		Metrics metrics;
+		metrics.open			= mOpen;
+		metrics.noiseFloor		= mFloor;
+		metrics.gatedSamples	= mGated;
+		metrics.passedSamples	= mPassed;
+		return metrics;
+	}
+	
+} // namespace sphinx
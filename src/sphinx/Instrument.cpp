@@ -0,0 +1,113 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Instrument.hpp"
+
+namespace sphinx {
+	
+	//! registered instruments, linked during static initialization and never removed
+	static std::atomic<Instrument*> sInstruments( nullptr );
+	
+	Instrument::Instrument(const char* name, Kind kind) :
+		mName( name ),
+		mKind( kind ),
+		mNext( sInstruments.load() )
+	{
+		while( ! sInstruments.compare_exchange_weak( mNext, this ) ) { /* retry */ }
+	}
+	
+	std::vector<Instrument::Sample> Instrument::snapshot()
+	{
+		std::vector<Sample> samples;
+		for( const Instrument* instrument = sInstruments.load(); instrument; instrument = instrument->mNext ) {
+			Sample s = { instrument->mName, instrument->mKind, 0, 0.0, 0.0, 0, 0 };
+			instrument->sample( &s );
+			samples.push_back( s );
+		}
+		return samples;
+	}
+	
+	void Instrument::reset()
+	{
+		for( Instrument* instrument = sInstruments.load(); instrument; instrument = instrument->mNext )
+			instrument->clear();
+	}
+	
+	void InstrumentTimer<true>::add(const ptmr_t& timer)
+	{
+		mCount.fetch_add( 1, std::memory_order_relaxed );
+		mCpuNs.fetch_add( uint64_t( timer.t_cpu * 1e9 ), std::memory_order_relaxed );
+		mWallNs.fetch_add( uint64_t( timer.t_elapsed * 1e9 ), std::memory_order_relaxed );
+	}
+	
+	void InstrumentTimer<true>::sample(Sample* output) const
+	{
+		output->count = mCount.load( std::memory_order_relaxed );
+		output->cpuSeconds = mCpuNs.load( std::memory_order_relaxed ) * 1e-9;
+		output->wallSeconds = mWallNs.load( std::memory_order_relaxed ) * 1e-9;
+	}
+	
+	void InstrumentTimer<true>::clear()
+	{
+		mCount = 0;
+		mCpuNs = 0;
+		mWallNs = 0;
+	}
+	
+	void InstrumentCounter<true>::sample(Sample* output) const
+	{
+		output->count = mCount.load( std::memory_order_relaxed );
+		output->value = mValue.load( std::memory_order_relaxed );
+	}
+	
+	void InstrumentCounter<true>::clear()
+	{
+		mCount = 0;
+		mValue = 0;
+	}
+	
+	void InstrumentGauge<true>::set(int64_t value)
+	{
+		mCount.fetch_add( 1, std::memory_order_relaxed );
+		mValue.store( value, std::memory_order_relaxed );
+		int64_t max = mMax.load( std::memory_order_relaxed );
+		while( value > max && ! mMax.compare_exchange_weak( max, value, std::memory_order_relaxed ) ) { /* retry */ }
+		Trace::counter( getName(), value );
+	}
+	
+	void InstrumentGauge<true>::sample(Sample* output) const
+	{
+		output->count = mCount.load( std::memory_order_relaxed );
+		output->value = mValue.load( std::memory_order_relaxed );
+		output->max = mMax.load( std::memory_order_relaxed );
+	}
+	
+	void InstrumentGauge<true>::clear()
+	{
+		mCount = 0;
+		mValue = 0;
+		mMax = 0;
+	}
+	
+} // namespace sphinx
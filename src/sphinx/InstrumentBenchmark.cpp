@@ -0,0 +1,171 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/InstrumentBenchmark.hpp"
+#include "sphinx/Instrument.hpp"
+#include "sphinx/Trace.hpp"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace sphinx {
+	
+	// Disabled instruments hold no state, only SPHINX_TRACE builds keep span names and spans:
+	static_assert( kTraceEnabled || std::is_empty<InstrumentTimer<false> >::value, "disabled timer must be empty" );
+	static_assert( std::is_empty<InstrumentCounter<false> >::value, "disabled counter must be empty" );
+	static_assert( std::is_empty<InstrumentGauge<false> >::value, "disabled gauge must be empty" );
+	static_assert( kTraceEnabled || std::is_empty<InstrumentScope<false> >::value, "disabled scope must be empty" );
+	static_assert( std::is_empty<TraceName<false> >::value && std::is_empty<TraceSpan<false> >::value, "disabled trace span must be empty" );
+	
+	//! block energy, the kind of per-block work the recognizer instruments
+	static inline int64_t energy(const int16_t* data, size_t size)
+	{
+		int64_t sum = 0;
+		for(size_t i = 0; i < size; i++)
+			sum += int32_t( data[ i ] ) * data[ i ];
+		return sum;
+	}
+	
+	//! uninstrumented kernel
+	struct KernelBare
+	{
+		static int64_t process(const int16_t* data, size_t size) { return energy( data, size ); }
+	};
+	
+	//! kernel instrumented with one scope, counter and gauge
+	template<bool Enabled>
+	struct KernelInstrumented
+	{
+		static InstrumentTimer<Enabled>		sTimer;
+		static InstrumentCounter<Enabled>	sCounter;
+		static InstrumentGauge<Enabled>		sGauge;
+		
+		static int64_t process(const int16_t* data, size_t size)
+		{
+			InstrumentScope<Enabled> scope( sTimer );
+			int64_t sum = energy( data, size );
+			sCounter.add( size );
+			sGauge.set( sum >> 16 );
+			return sum;
+		}
+	};
+	
+	template<bool Enabled> InstrumentTimer<Enabled> KernelInstrumented<Enabled>::sTimer( Enabled ? "benchmark_enabled" : "benchmark_disabled" );
+	template<bool Enabled> InstrumentCounter<Enabled> KernelInstrumented<Enabled>::sCounter( Enabled ? "benchmark_enabled_samples" : "benchmark_disabled_samples" );
+	template<bool Enabled> InstrumentGauge<Enabled> KernelInstrumented<Enabled>::sGauge( Enabled ? "benchmark_enabled_energy" : "benchmark_disabled_energy" );
+	
+	//! times kernel calls, each variant gets its own loop so codegen differs only by instrumentation
+	template<typename Kernel>
+	static double measure(const std::vector<int16_t>& data, size_t blockSize, size_t iterations)
+	{
+		static volatile int64_t sink = 0;
+		int64_t sum = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < iterations; i++)
+			sum += Kernel::process( data.data() + i % 64, blockSize );
+		std::chrono::duration<double,std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+		sink = sink + sum;
+		return elapsed.count() / iterations;
+	}
+	
+	//! instrument storage, zero for empty disabled instruments
+	template<bool Enabled>
+	static size_t instrumentBytes()
+	{
+		typedef KernelInstrumented<Enabled> K;
+		return ( std::is_empty<decltype( K::sTimer )>::value ? 0 : sizeof( K::sTimer ) )
+			+ ( std::is_empty<decltype( K::sCounter )>::value ? 0 : sizeof( K::sCounter ) )
+			+ ( std::is_empty<decltype( K::sGauge )>::value ? 0 : sizeof( K::sGauge ) );
+	}
+	
+	InstrumentBenchmark::InstrumentBenchmark() :
+		mBlockSize( 160 ),
+		mIterations( 200000 ),
+		mRepeats( 5 )
+	{
+		/* no-op */
+	}
+	
+	std::vector<InstrumentBenchmark::Result> InstrumentBenchmark::run(const ci::fs::path& tracePath) const
+	{
+		// Create deterministic block, varied per call so the kernel cannot be hoisted:
+		std::vector<int16_t> data( mBlockSize + 64 );
+		uint32_t seed = 1;
+		for( auto& sample : data ) {
+			seed = seed * 1664525u + 1013904223u;
+			sample = int16_t( seed >> 16 );
+		}
+		
+		const char* variants[] = { "bare", "disabled", "enabled", "enabled-tracing" };
+		size_t numVariants = tracePath.empty() ? 3 : 4;
+		std::vector<double> best( numVariants, std::numeric_limits<double>::max() );
+		
+		// Interleave variants across repeats so drift affects each equally:
+		for(size_t repeat = 0; repeat < mRepeats; repeat++) {
+			for(size_t v = 0; v < numVariants; v++) {
+				double ns;
+				if( v == 0 )
+					ns = measure<KernelBare>( data, mBlockSize, mIterations );
+				else if( v == 1 )
+					ns = measure<KernelInstrumented<false> >( data, mBlockSize, mIterations );
+				else if( v == 2 )
+					ns = measure<KernelInstrumented<true> >( data, mBlockSize, mIterations );
+				else {
+					Trace::start( tracePath );
+					ns = measure<KernelInstrumented<true> >( data, mBlockSize, mIterations );
+					Trace::stop();
+				}
+				best[ v ] = std::min( best[ v ], ns );
+			}
+		}
+		
+		std::vector<Result> results;
+		for(size_t v = 0; v < numVariants; v++) {
+			Result r;
+			r.variant = variants[ v ];
+			r.iterations = mIterations;
+			r.nsPerIteration = best[ v ];
+			r.overheadNs = best[ v ] - best[ 0 ];
+			r.instrumentBytes = v == 0 ? 0 : ( v == 1 ? instrumentBytes<false>() : instrumentBytes<true>() );
+			results.push_back( r );
+		}
+		return results;
+	}
+	
+	void InstrumentBenchmark::writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath)
+	{
+		std::ofstream fh( csvPath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not write instrumentation benchmark report: \"" + csvPath.string() + "\"" );
+		
+		fh << "variant,iterations,ns_per_iteration,overhead_ns,instrument_bytes\n";
+		for( const auto& r : results )
+			fh << r.variant << "," << r.iterations << "," << r.nsPerIteration << "," << r.overheadNs << "," << r.instrumentBytes << "\n";
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,139 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/LoadShedder.hpp"
+
+namespace sphinx {
+	
+	LoadShedder::Format::Format() :
+		mUpperLoad( 0.9 ),
+		mLowerLoad( 0.5 ),
+		mSmoothing( 0.05 ),
+		mCooldown( 5.0 ),
+		mAllowReinit( false )
+	{
+		// Progressively cheaper search, all applied in place between utterances:
+		mLevels.push_back( { 1e-44, 1e-26, 10000, 0 } );
+		mLevels.push_back( { 1e-38, 1e-24, 5000, 0 } );
+		mLevels.push_back( { 1e-30, 1e-20, 2000, 0 } );
+		mLevels.push_back( { 1e-25, 1e-16, 1000, 0 } );
+	}
+	
+	LoadShedder::LoadShedder(const Format& format, const AdjustFn& adjustCb) :
+		mFormat( format ),
+		mAdjustCb( adjustCb ),
+		mSinceChange( 0.0 ),
+		mLevel( 0 ),
+		mLoad( 0.0 ),
+		mTightened( 0 ),
+		mRelaxed( 0 ),
+		mFailed( 0 )
+	{
+		if( format.getLowerLoad() >= format.getUpperLoad() )
+			throw std::runtime_error( "Invalid load shedding format: lower load must be below upper load" );
+		if( format.getSmoothing() <= 0.0 || format.getSmoothing() > 1.0 )
+			throw std::runtime_error( "Invalid load shedding format: smoothing must be in (0,1]" );
+		for( const auto& level : format.getLevels() ) {
+			if( level.ds > 0 && ! format.getAllowReinit() )
+				throw std::runtime_error( "Invalid load shedding format: levels changing -ds need allowReinit" );
+		}
+	}
+	
+	void LoadShedder::update(double processSeconds, double audioSeconds)
+	{
+		if( audioSeconds <= 0.0 )
+			return;
+		double alpha = mFormat.getSmoothing();
+		mLoad = ( 1.0 - alpha ) * mLoad + alpha * ( processSeconds / audioSeconds );
+		mSinceChange += audioSeconds;
+	}
+	
+	bool LoadShedder::poll(size_t* targetLevel) const
+	{
+		if( mSinceChange < mFormat.getCooldown() )
+			return false;
+		
+		size_t level = mLevel;
+		double load = mLoad;
+		
+		// Hysteresis band between lower and upper load keeps current level:
+		if( load > mFormat.getUpperLoad() && level < mFormat.getLevels().size() ) {
+			*targetLevel = level + 1;
+			return true;
+		}
+		if( load < mFormat.getLowerLoad() && level > 0 ) {
+			*targetLevel = level - 1;
+			return true;
+		}
+		return false;
+	}
+	
+	void LoadShedder::commit(size_t level)
+	{
+		size_t previous = mLevel.exchange( level );
+		if( level > previous )
+			mTightened++;
+		else if( level < previous )
+			mRelaxed++;
+		mSinceChange = 0.0;
+		
+		if( mAdjustCb && level != previous )
+			mAdjustCb( previous, level, mLoad );
+	}
+	
+	void LoadShedder::reject()
+	{
+		mFailed++;
+		mSinceChange = 0.0;
+	}
+	
+	RecognizerConfig LoadShedder::configure(const RecognizerConfig& base, size_t level) const
+	{
+		if( level == 0 || level > mFormat.getLevels().size() )
+			return base;
+		return apply( base, mFormat.getLevels()[ level - 1 ] );
+	}
+	
+	RecognizerConfig LoadShedder::apply(const RecognizerConfig& base, const Level& l)
+	{
+		RecognizerConfig config = base;
+		if( l.beam > 0.0 )		config.beam( l.beam );
+		if( l.wbeam > 0.0 )		config.wbeam( l.wbeam );
+		if( l.maxhmmpf > 0 )	config.maxhmmpf( l.maxhmmpf );
+		if( l.ds > 0 )			config.ds( l.ds );
+		return config;
+	}
+	
+	LoadShedder::Metrics LoadShedder::getMetrics() const
+	{
+		Metrics metrics;
+		metrics.level		= mLevel;
+		metrics.load		= mLoad;
+		metrics.tightened	= mTightened;
+		metrics.relaxed		= mRelaxed;
+		metrics.failed		= mFailed;
+		return metrics;
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,133 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/MemoryReport.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace sphinx {
+	
+	//! approximate bytes of one small sphinxbase hash table, two per FSG state
+	static const size_t kHashTableBytes = 64;
+	
+	MemoryReport::MemoryReport() :
+		grammarBytes( 0 ),
+		acousticModelBytes( 0 ),
+		acousticModelMapped( false ),
+		dictionaryEntries( 0 ),
+		dictionaryBytes( 0 ),
+		dictionaryMapped( false ),
+		latticeNodes( 0 ),
+		latticeLinks( 0 ),
+		rawDataBytes( 0 ),
+		bufferBytes( 0 ),
+		decoders( 0 ),
+		processMappedBytes( 0 ),
+		processPrivateBytes( 0 )
+	{
+		/* no-op */
+	}
+	
+	size_t MemoryReport::getMappedBytes() const
+	{
+		return ( acousticModelMapped ? acousticModelBytes : 0 ) + ( dictionaryMapped ? dictionaryBytes : 0 );
+	}
+	
+	size_t MemoryReport::getPrivateBytes() const
+	{
+		return ( acousticModelMapped ? 0 : acousticModelBytes ) + ( dictionaryMapped ? 0 : dictionaryBytes ) + grammarBytes + rawDataBytes + bufferBytes;
+	}
+	
+	MemoryReport::Grammar MemoryReport::measureGrammar(const std::string& key, fsg_model_t* model)
+	{
+		Grammar g;
+		g.key = key;
+		g.states = fsg_model_n_state( model );
+		g.words = fsg_model_n_word( model );
+		g.transitions = 0;
+		
+		// Count transitions out of every state:
+		for(int32 state = 0; state < fsg_model_n_state( model ); state++)
+			for(fsg_arciter_t* iter = fsg_model_arcs( model, state ); iter; iter = fsg_arciter_next( iter ))
+				g.transitions++;
+		
+		// Estimate heap: links, per-state transition tables (two hash tables each) and vocabulary strings:
+		g.bytes = g.transitions * sizeof( fsg_link_t ) + g.states * 2 * kHashTableBytes + size_t( model->n_word_alloc ) * sizeof( char* );
+		for(int32 wid = 0; wid < fsg_model_n_word( model ); wid++)
+			g.bytes += strlen( fsg_model_word_str( model, wid ) ) + 1;
+		return g;
+	}
+	
+	size_t MemoryReport::measureDirectory(const ci::fs::path& dirPath)
+	{
+		size_t bytes = 0;
+		try {
+			if( ! ci::fs::is_directory( dirPath ) )
+				return 0;
+			for( ci::fs::directory_iterator it( dirPath ), end; it != end; ++it )
+				if( ci::fs::is_regular_file( it->path() ) )
+					bytes += size_t( ci::fs::file_size( it->path() ) );
+		}
+		catch( ... ) {
+			// Report what could be read:
+		}
+		return bytes;
+	}
+	
+	bool MemoryReport::measureProcess(size_t* mappedBytes, size_t* privateBytes)
+	{
+		*mappedBytes = 0;
+		*privateBytes = 0;
+#if defined( __linux__ )
+		std::ifstream fh( "/proc/self/smaps_rollup" );
+		std::string line;
+		size_t rss = 0, anonymous = 0;
+		
+		// Skip address range header, then read "Key: N kB" lines:
+		std::getline( fh, line );
+		while( std::getline( fh, line ) ) {
+			std::istringstream fields( line );
+			std::string key;
+			size_t value;
+			if( ! ( fields >> key >> value ) )
+				continue;
+			if( key == "Rss:" )
+				rss = value * 1024;
+			else if( key == "Anonymous:" )
+				anonymous = value * 1024;
+			else if( key == "Private_Dirty:" )
+				*privateBytes = value * 1024;
+		}
+		
+		// Resident file-backed bytes are everything resident that is not anonymous:
+		*mappedBytes = rss > anonymous ? rss - anonymous : 0;
+		return rss > 0;
+#else
+		return false;
+#endif
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,254 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/MultiChannelRecognizer.hpp"
+
+#include <algorithm>
+
+#include "cinder/audio/Device.h"
+
+namespace sphinx {
+	
+	//! per-channel resampling instrument, compiled out unless built with SPHINX_INSTRUMENT
+	static InstrumentTimer<> sChannelResampleTimer( "channel_resample" );
+	
+	MultiChannelRecognizer::MultiChannelRecognizer(size_t numThreads) :
+		mNumThreads( numThreads ),
+		mStop( false ),
+		mGeneration( 0 ),
+		mPending( 0 ),
+		mNextChannel( 0 )
+	{
+		/* no-op */
+	}
+	
+	MultiChannelRecognizerRef MultiChannelRecognizer::create(const RecognizerConfig& settings, size_t numChannels, size_t numThreads)
+	{
+		if( numChannels == 0 )
+			throw std::runtime_error( "Could not create multi-channel recognizer: channel count is zero" );
+		if( numThreads == 0 )
+			numThreads = std::min<size_t>( numChannels, std::max( 1u, std::thread::hardware_concurrency() ) );
+		
+		MultiChannelRecognizerRef r = MultiChannelRecognizerRef( new MultiChannelRecognizer( std::min( numThreads, numChannels ) ) );
+		
+		// Load decoders in the background, rethrowing the first failure; Recognizer serializes ps_init, which shares the log stream:
+		for(size_t i = 0; i < numChannels; i++)
+			r->mChannels.push_back( Recognizer::createAsync( settings ) );
+		for( const auto& channel : r->mChannels )
+			channel->getReadyFuture().get();
+		
+		return r;
+	}
+	
+	MultiChannelRecognizer::~MultiChannelRecognizer()
+	{
+		// Set stop flag and wake threads:
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mStop = true;
+		}
+		mWorkCv.notify_all();
+		mDoneCv.notify_all();
+		if( mSource ) mSource->interrupt();
+		// Join threads:
+		if( mReader.joinable() ) mReader.join();
+		for( auto& w : mWorkers )
+			if( w.joinable() ) w.join();
+	}
+	
+	void MultiChannelRecognizer::connectEventHandler(const std::function<void(size_t, const std::string&)>& eventCb)
+	{
+		for(size_t i = 0; i < mChannels.size(); i++)
+			mChannels[ i ]->connectEventHandler( [eventCb, i](const std::string& message) { eventCb( i, message ); } );
+	}
+	
+	void MultiChannelRecognizer::addModelJsgf(const std::string& key, const ci::fs::path& jsgfPath, bool setActive)
+	{
+		for( const auto& channel : mChannels )
+			channel->addModelJsgf( key, jsgfPath, setActive );
+	}
+	
+	void MultiChannelRecognizer::addModelJsgf(const std::string& key, const std::string& jsgfData, bool setActive)
+	{
+		for( const auto& channel : mChannels )
+			channel->addModelJsgf( key, jsgfData, setActive );
+	}
+	
+	void MultiChannelRecognizer::setActiveModel(const std::string& key)
+	{
+		for( const auto& channel : mChannels )
+			channel->setActiveModel( key );
+	}
+	
+	std::vector<ThreadPolicy::Result> MultiChannelRecognizer::getThreadPolicyResults() const
+	{
+		std::lock_guard<std::mutex> lock( mPolicyMutex );
+		return mPolicyResults;
+	}
+	
+	void MultiChannelRecognizer::read()
+	{
+		ThreadPolicy::Result policy = mThreadPolicy.apply();
+		{
+			std::lock_guard<std::mutex> lock( mPolicyMutex );
+			mPolicyResults[ 0 ] = policy;
+		}
+		Trace::setThreadName( "multichannel-reader" );
+		
+		while( ! mStop && mSource->read( &mBlock ) ) {
+			// Account for audio lost ahead of block, dropping stale utterances after a skip to live:
+			for( const auto& channel : mChannels ) {
+				if( mBlock.droppedBlocks > 0 )
+					channel->markDropped( mBlock.droppedBlocks, mBlock.droppedFrames * 16000 / mSource->getSampleRate() );
+				if( mBlock.discontinuity )
+					channel->discard();
+			}
+			
+			// Publish block to workers:
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mNextChannel = 0;
+				mPending = mChannels.size();
+				mGeneration++;
+			}
+			mWorkCv.notify_all();
+			
+			// Source block stays valid until every channel is decoded:
+			std::unique_lock<std::mutex> lock( mMutex );
+			mDoneCv.wait( lock, [this]() { return mPending == 0 || mStop; } );
+		}
+		
+		// Deliver final utterances of a finite source:
+		if( ! mStop )
+			for( const auto& channel : mChannels )
+				channel->finish();
+	}
+	
+	void MultiChannelRecognizer::work(size_t index)
+	{
+		ThreadPolicy::Result policy = mThreadPolicy.withSuffix( "-" + std::to_string( index ) ).apply();
+		{
+			std::lock_guard<std::mutex> lock( mPolicyMutex );
+			mPolicyResults[ index + 1 ] = policy;
+		}
+		Trace::setThreadName( "multichannel-worker" );
+		
+		uint64_t generation = 0;
+		
+		while( true ) {
+			{
+				std::unique_lock<std::mutex> lock( mMutex );
+				mWorkCv.wait( lock, [&]() { return mStop || mGeneration != generation; } );
+				if( mStop )
+					return;
+				generation = mGeneration;
+			}
+			
+			// Claim channels until block is exhausted:
+			for(size_t channel = mNextChannel++; channel < mChannels.size(); channel = mNextChannel++) {
+				decodeChannel( channel );
+				std::lock_guard<std::mutex> lock( mMutex );
+				if( --mPending == 0 )
+					mDoneCv.notify_one();
+			}
+		}
+	}
+	
+	void MultiChannelRecognizer::decodeChannel(size_t channel)
+	{
+		size_t numChannels = mChannels.size();
+		size_t numFrames = mBlock.numFrames;
+		int16_t* data = mData[ channel ].data();
+		size_t size;
+		
+		if( mBlock.buffer ) {
+			// Float sources are non-interleaved, so the channel is read in place:
+			SPHINX_TIMED_SCOPE( sChannelResampleTimer );
+			size = mResamplers[ channel ]->process( mBlock.buffer->getChannel( channel ), numFrames, data );
+		}
+		else if( ! mResamplers[ channel ] ) {
+			// Gather 16 kHz int16 channel into decoder input:
+			for(size_t i = 0; i < numFrames; i++)
+				data[ i ] = mBlock.pcm[ i * numChannels + channel ];
+			size = numFrames;
+		}
+		else {
+			SPHINX_TIMED_SCOPE( sChannelResampleTimer );
+			convertInt16ToFloat( mBlock.pcm + channel, mScratch[ channel ].data(), numFrames, numChannels );
+			size = mResamplers[ channel ]->process( mScratch[ channel ].data(), numFrames, data );
+		}
+		
+		mChannels[ channel ]->decode( data, size );
+	}
+	
+	void MultiChannelRecognizer::start()
+	{
+		// Get audio context:
+		auto ctx = ci::audio::Context::master();
+		// Create input node with one channel per recognizer:
+		mInputNode = ctx->createInputDeviceNode( ci::audio::Device::getDefaultInput(), ci::audio::Node::Format().channels( mChannels.size() ) );
+		// Create capture node queuing every device block, one second deep:
+		size_t blockFrames = ctx->getFramesPerBlock();
+		auto queueFormat = CaptureQueue::Format()
+			.sampleRate( ctx->getSampleRate() )
+			.channels( mChannels.size() )
+			.sampleType( AudioSource::SampleType::Float )
+			.blockFrames( blockFrames )
+			.capacity( ctx->getSampleRate() / blockFrames );
+		mCaptureNode = ctx->makeNode( new CaptureNode( CaptureQueue::create( queueFormat ) ) );
+		// Attach capture to input:
+		mInputNode >> mCaptureNode;
+		// Enable audio input device and context:
+		mInputNode->enable();
+		ctx->enable();
+		// Read from capture queue:
+		start( mCaptureNode->getQueue() );
+	}
+	
+	void MultiChannelRecognizer::start(const AudioSourceRef& source)
+	{
+		if( ! source )
+			throw std::runtime_error( "Could not start recognizer: audio source is null" );
+		if( source->getNumChannels() != mChannels.size() )
+			throw std::runtime_error( "Could not start recognizer: audio source channel count does not match" );
+		mSource = source;
+		
+		// Create per-channel conversion state, int16 sources at 16 kHz need none:
+		size_t maxFrames = source->getMaxFramesPerBlock();
+		bool resample = source->getSampleType() == AudioSource::SampleType::Float || source->getSampleRate() != 16000;
+		for(size_t i = 0; i < mChannels.size(); i++) {
+			mResamplers.push_back( resample ? Resampler::create( source->getSampleRate(), 1, maxFrames ) : ResamplerRef() );
+			mData.push_back( std::vector<int16_t>( resample ? mResamplers.back()->getMaxOutputFrames() : maxFrames ) );
+			bool deinterleave = resample && source->getSampleType() == AudioSource::SampleType::Int16;
+			mScratch.push_back( std::vector<float>( deinterleave ? maxFrames : 0 ) );
+		}
+		
+		// Start worker and reader threads:
+		mPolicyResults.resize( mNumThreads + 1 );
+		for(size_t i = 0; i < mNumThreads; i++)
+			mWorkers.push_back( std::thread( &MultiChannelRecognizer::work, this, i ) );
+		mReader = std::thread( &MultiChannelRecognizer::read, this );
+	}
+	
+} // namespace sphinx
@@ -26,6 +26,54 @@
 
 namespace sphinx {
 	
+	//! maximum amount of audio buffered while decoder initializes (10 seconds at 16 kHz)
+	static const size_t kMaxEarlyAudioSamples = 16000 * 10;
+	
+	//! block size for decoding audio captured during initialization (20 ms at 16 kHz)
+	static const size_t kEarlyAudioBlockSamples = 320;
+	
+	//! default speech onset pre-roll withheld by the energy gate (300 ms at 16 kHz)
+	static const size_t kDefaultPreRollSamples = 16000 * 300 / 1000;
+	
+	//! live decoders in process
+	static std::atomic<size_t> sLiveDecoders( 0 );
+	
+	//! serializes decoder initialization and the process-wide log stream it writes to
+	static std::mutex sDecoderInitMutex;
+	
+	//! points sphinxbase's process-wide log stream at file, or disables it for an empty path or /dev/null; called with sDecoderInitMutex held
+	static void applyLogFile(const ci::fs::path& logPath)
+	{
+		static std::string sLogPath;
+		static bool sLogApplied = false;
+		
+		std::string path = logPath.string();
+		if( sLogApplied && path == sLogPath )
+			return;
+		
+		if( path.empty() || path == "/dev/null" ) {
+			err_set_logfp( NULL );
+		}
+		else {
+			// Replaced streams are never closed, decoders on other threads may still be writing to them:
+			FILE* fh = fopen( path.c_str(), "a" );
+			if( fh == NULL )
+				throw std::runtime_error( "Could not open decoder log: \"" + path + "\"" );
+			err_set_logfp( fh );
+		}
+		sLogPath = path;
+		sLogApplied = true;
+	}
+	
+	//! hot-path instruments, compiled out unless built with SPHINX_INSTRUMENT
+	static InstrumentTimer<>	sConvertTimer( "convert" );
+	static InstrumentTimer<>	sResampleTimer( "resample" );
+	static InstrumentTimer<>	sProcessTimer( "ps_process_raw" );
+	static InstrumentTimer<>	sEndUttTimer( "ps_end_utt" );
+	static InstrumentTimer<>	sHandlerTimer( "handler" );
+	static InstrumentGauge<>	sQueueGauge( "queue_depth" );
+	static InstrumentCounter<>	sDroppedCounter( "dropped_samples" );
+	
 	static void loadTextFile(const ci::fs::path& filePath, std::string* output)
 	{
 		std::string line;
@@ -40,12 +88,29 @@ namespace sphinx {
 		}
 	}
 	
-	static void convertFloatToInt16(const float* sourceArray, int16_t* destArray, size_t length)
+	//! returns element at index of reusable result, reviving an element parked by an earlier shorter result so its string capacity is kept
+	template<typename T>
+	static T& reuseElement(std::vector<T>* items, std::vector<T>* spare, size_t index)
 	{
-		const float intNormalizer = 32768.0f;
-		
-		for(size_t i = 0; i < length; i++) {
-			destArray[ i ] = int16_t( sourceArray[i] * intNormalizer );
+		if( index == items->size() ) {
+			if( spare->empty() ) {
+				items->emplace_back();
+			}
+			else {
+				items->push_back( std::move( spare->back() ) );
+				spare->pop_back();
+			}
+		}
+		return ( *items )[ index ];
+	}
+	
+	//! shrinks reusable result to size, parking surplus elements instead of freeing them
+	template<typename T>
+	static void reuseResize(std::vector<T>* items, std::vector<T>* spare, size_t size)
+	{
+		while( items->size() > size ) {
+			spare->push_back( std::move( items->back() ) );
+			items->pop_back();
 		}
 	}
 	
@@ -53,126 +118,865 @@ namespace sphinx {
 	{
 		char const* message = ps_get_hyp( decoder, NULL );
 		
-		if( mCb != nullptr && message != NULL && strlen( message ) > 0 )
-			mCb( std::string( message ) );
+		if( mCb != nullptr && message != NULL && strlen( message ) > 0 ) {
+			mMessage.assign( message );
+			mCb( mMessage );
+		}
 	}
 	
 	void EventHandlerSegment::event(ps_decoder_t* decoder)
 	{
-		std::vector<std::string> segments;
+		size_t count = 0;
 		
 		ps_seg_t* iter = ps_seg_iter( decoder, NULL );
 		
 		while( iter != NULL ) {
-			segments.push_back( std::string( ps_seg_word( iter ) ) );
+			reuseElement( &mSegments, &mSpare, count++ ).assign( ps_seg_word( iter ) );
 			iter = ps_seg_next( iter );
 		}
+		reuseResize( &mSegments, &mSpare, count );
 		
-		if( ! segments.empty() )
-			mCb( segments );
+		if( ! mSegments.empty() )
+			mCb( mSegments );
 	}
 	
 	void EventHandlerSegmentConfidence::event(ps_decoder_t *decoder)
 	{
-		std::vector<std::pair<std::string,float> > segments;
+		size_t count = 0;
 		
 		ps_seg_t* iter = ps_seg_iter( decoder, NULL );
 		
 		while( iter != NULL ) {
 			int32 prob = ps_seg_prob( iter, NULL, NULL, NULL );
-			segments.push_back( { std::string( ps_seg_word( iter ) ), logmath_exp( ps_get_logmath( decoder ), prob ) } );
+			std::pair<std::string,float>& segment = reuseElement( &mSegments, &mSpare, count++ );
+			segment.first.assign( ps_seg_word( iter ) );
+			segment.second = logmath_exp( ps_get_logmath( decoder ), prob );
 			iter = ps_seg_next( iter );
 		}
+		reuseResize( &mSegments, &mSpare, count );
 		
-		if( ! segments.empty() )
-			mCb( segments );
+		if( ! mSegments.empty() )
+			mCb( mSegments );
 	}
 	
 	Recognizer::Recognizer() :
 		mStop( false ),
 		mThread(),
+		mReady( false ),
+		mFailed( false ),
+		mReadyFuture( mReadyPromise.get_future().share() ),
+		mAgcEmax( 0.0f ),
+		mAdaptPending( false ),
+		mPreRoll( kDefaultPreRollSamples ),
+		mReplayPending( false ),
+		mDecoding( false ),
+		mTrackLattices( false ),
+		mLatticeNodes( 0 ),
+		mLatticeLinks( 0 ),
+		mRawDataBytes( 0 ),
+		mBufferBytes( 0 ),
 		mConfig( NULL ),
-		mDecoder( NULL )
+		mDecoder( NULL ),
+		mCaptureOverflow( CaptureQueue::Overflow::DropOldest ),
+		mCaptureMs( 1000 ),
+		mRecorderPending( false ),
+		mPartialSamples( 0 ),
+		mSincePartial( 0 ),
+		mUttStarted( 0 ),
+		mUttIndex( 0 ),
+		mUttPartials( false ),
+		mUttDropped( 0 ),
+		mTraceSession( Trace::newSession() )
 	{
 		/* no-op */
 	}
 	
-	void Recognizer::initialize(const ci::fs::path& hmmPath, const ci::fs::path& dictPath)
+	void Recognizer::initialize(const RecognizerConfig& settings)
 	{
-		// Configure recognizer:
-		mConfig = cmd_ln_init( NULL, ps_args(), true, "-hmm", hmmPath.c_str(), "-dict", dictPath.c_str(), "-logfn", "/dev/null", NULL );
+		mSettings = settings;
 		
-		if( mConfig == NULL )
-			throw std::runtime_error( "Could not configure speech recognizer" );
+		// Configure recognizer:
+		bool pruneDict = settings.getPruneDict() || Dictionary::isCache( settings.getDict() );
+		if( pruneDict ) {
+			// Decoder starts with filler words only, model words are added from source dictionary as models arrive:
+			mDictionary = Dictionary::create( settings.getDict(), mVocabulary );
+		}
+		mConfig = settings.createCmdLn( ! pruneDict );
 		
-		// Initialize recognizer:
-		mDecoder = ps_init( mConfig );
+		// Initialize recognizer, one decoder at a time across threads:
+		{
+			std::lock_guard<std::mutex> lock( sDecoderInitMutex );
+			applyLogFile( settings.getLogFile() );
+			mDecoder = ps_init( mConfig );
+		}
 		
 		if( mDecoder == NULL )
 			throw std::runtime_error( "Could not initialize speech recognizer" );
+		sLiveDecoders++;
+		
+		// Apply deferred model operations and mark ready:
+		std::lock_guard<std::mutex> lock( mInitMutex );
+		for( const auto& op : mDeferred )
+			op();
+		mDeferred.clear();
+		mReady = true;
+		mReadyPromise.set_value();
+	}
+	
+	void Recognizer::initializeAsync(const RecognizerConfig& settings, const std::function<void()>& readyCb)
+	{
+		try {
+			initialize( settings );
+		}
+		catch( ... ) {
+			mFailed = true;
+			mReadyPromise.set_exception( std::current_exception() );
+			return;
+		}
+		
+		if( readyCb )
+			readyCb();
+	}
+	
+	void Recognizer::whenReady(const std::function<void()>& op)
+	{
+		{
+			std::lock_guard<std::mutex> lock( mInitMutex );
+			if( ! mReady ) {
+				mDeferred.push_back( op );
+				return;
+			}
+		}
+		op();
 	}
 	
 	void Recognizer::run()
 	{
-		// Create audio converter:
-		auto converter = ci::audio::dsp::Converter::create( mMonitorNode->getSampleRate(), 16000, mMonitorNode->getNumChannels(), 1, mMonitorNode->getFramesPerBlock() );
-		// Create buffer for converted audio:
-		ci::audio::Buffer destBuffer( converter->getDestMaxFramesPerBlock(), converter->getDestNumChannels() );
+		mStats.recordThreadPolicy( mThreadPolicy.apply() );
+		Trace::setSession( mTraceSession );
+		Trace::setThreadName( "recognizer" );
 		
-		bool utt_started, in_speech;
-
-		if( ps_start_utt( mDecoder ) < 0 )
-			throw std::runtime_error( "Could not start utterance" );
+		// Sources already in decoder format are decoded from their own buffers:
+		bool direct = mSource->isDecoderFormat();
+		size_t maxFrames = mSource->getMaxFramesPerBlock();
+		
+		// Create resampler, a polyphase decimator for integer ratios and the generic converter otherwise:
+		ResamplerRef resampler;
+		ci::audio::Buffer floatBuffer;
+		if( ! direct )
+			resampler = Resampler::create( mSource->getSampleRate(), mSource->getNumChannels(), maxFrames );
+		
+		// Create buffers for converted audio and its float equivalent for the energy gate:
+		std::vector<int16_t> data( direct ? 0 : resampler->getMaxOutputFrames() );
+		std::vector<float> analysis( mGate ? ( direct ? maxFrames : resampler->getMaxOutputFrames() ) : 0 );
 		
-		utt_started = false;
+		AudioSource::Block block;
+		bool exhausted = false;
 		
 		while( ! mStop ) {
-			// Convert buffer:
-			std::pair<size_t,size_t> convertResult = converter->convert( &( mMonitorNode->getBuffer() ), &destBuffer );
-
-			// Convert buffer data:
-			int16_t* data = new int16_t[ convertResult.second ];
-			convertFloatToInt16( destBuffer.getData(), data, convertResult.second );
+			// Stop if decoder could not be initialized:
+			if( mFailed )
+				break;
 			
-			// Process buffer:
-			ps_process_raw( mDecoder, data, convertResult.second, false, false );
+			// Swap recorder between blocks, never while the decoder is using it:
+			applyRecorder();
 			
-			// Cleanup buffer data:
-			delete[] data;
+			// Read and convert buffer:
+			const int16_t* pcm = NULL;
+			size_t size = 0;
+			if( ! exhausted && ! mSource->read( &block ) )
+				exhausted = true;
+			else if( ! exhausted ) {
+				mStats.recordBlock();
+				mStats.recordQueueDepth( mSource->getQueuedFrames() * 16000 / mSource->getSampleRate() );
+				SPHINX_GAUGE( sQueueGauge, mSource->getQueuedFrames() );
+				
+				// Account for audio lost ahead of block, dropping a stale utterance after a skip to live:
+				if( block.droppedBlocks > 0 )
+					markDropped( block.droppedBlocks, block.droppedFrames * 16000 / mSource->getSampleRate() );
+				if( block.discontinuity && mReady )
+					discard();
+				
+				if( direct ) {
+					pcm = block.pcm;
+					size = block.numFrames;
+					if( mGate ) {
+						SPHINX_TIMED_SCOPE( sConvertTimer );
+						convertInt16ToFloat( pcm, analysis.data(), size );
+					}
+				}
+				else {
+					const ci::audio::Buffer* buffer = block.buffer;
+					if( ! buffer ) {
+						// Deinterleave int16 source for resampling:
+						SPHINX_TIMED_SCOPE( sConvertTimer );
+						if( floatBuffer.getNumFrames() != block.numFrames )
+							floatBuffer = ci::audio::Buffer( block.numFrames, mSource->getNumChannels() );
+						for(size_t ch = 0; ch < floatBuffer.getNumChannels(); ch++)
+							convertInt16ToFloat( block.pcm + ch, floatBuffer.getChannel( ch ), block.numFrames, floatBuffer.getNumChannels() );
+						buffer = &floatBuffer;
+					}
+					SPHINX_TIMED_SCOPE( sResampleTimer );
+					pcm = data.data();
+					size = resampler->process( *buffer, data.data(), mGate ? analysis.data() : NULL );
+				}
+			}
 			
-			in_speech = static_cast<bool>( ps_get_in_speech( mDecoder ) );
+			if( mStop )
+				break;
 			
-			if( in_speech && ! utt_started ) {
-				utt_started = true;
+			if( mReady ) {
+				decodeBlock( pcm, size, analysis.data() );
+				
+				// Deliver final utterance of a finite source:
+				if( exhausted ) {
+					finish();
+					break;
+				}
+			}
+			else if( exhausted ) {
+				// Wait for decoder to drain audio held during initialization:
+				std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			}
+			else {
+				// Hold buffer until decoder is ready, keeping most recent audio:
+				mEarlyAudio.insert( mEarlyAudio.end(), pcm, pcm + size );
+				if( mEarlyAudio.size() > kMaxEarlyAudioSamples ) {
+					size_t overflow = mEarlyAudio.size() - kMaxEarlyAudioSamples;
+					mEarlyAudio.erase( mEarlyAudio.begin(), mEarlyAudio.begin() + overflow );
+					mStats.recordDrop( 0, overflow );
+				}
+				mStats.recordQueueDepth( mEarlyAudio.size() );
+				measureBuffers();
+			}
+		}
+	}
+	
+	void Recognizer::decodeBlock(const int16_t* data, size_t size, const float* analysis)
+	{
+		// Decoder lost to a failed reinitialization:
+		if( mFailed )
+			return;
+		
+		if( ! mDecoding ) {
+			startUtterance();
+			mDecoding = true;
+		}
+		
+		// Decode audio captured during initialization in live-sized blocks, so gate, endpointer and load measurement see it as they would live:
+		if( ! mEarlyAudio.empty() ) {
+			std::vector<int16_t> early;
+			early.swap( mEarlyAudio );
+			mStats.recordQueueDepth( 0 );
+			float earlyAnalysis[ kEarlyAudioBlockSamples ];
+			for(size_t pos = 0; pos < early.size(); pos += kEarlyAudioBlockSamples) {
+				size_t blockSize = std::min( kEarlyAudioBlockSamples, early.size() - pos );
+				if( mGate )
+					convertInt16ToFloat( early.data() + pos, earlyAnalysis, blockSize );
+				decodeBlock( early.data() + pos, blockSize, earlyAnalysis );
+			}
+		}
+		
+		if( size == 0 )
+			return;
+		
+		// Process buffer:
+		if( gate( analysis, data, size ) ) {
+			// Replay audio withheld just before gate opened, which decoder has not seen:
+			if( mReplayPending ) {
+				mReplayPending = false;
+				mPreRoll.replay( [this](const int16_t* replay, size_t replaySize) { process( replay, replaySize ); } );
 			}
+			process( data, size );
+		}
+		else {
+			// Keep withheld audio for replay on opening:
+			mPreRoll.push( data, size );
+			// Withheld audio costs no decode time:
+			if( mLoadShedder )
+				mLoadShedder->update( 0.0, size / 16000.0 );
+		}
+	}
+	
+	MemoryReport Recognizer::memoryReport() const
+	{
+		MemoryReport report;
+		report.decoders = sLiveDecoders;
+		MemoryReport::measureProcess( &report.processMappedBytes, &report.processPrivateBytes );
+		
+		// Wrapper-owned audio buffers, as measured on the decoding thread:
+		report.bufferBytes = mBufferBytes;
+		if( mCaptureNode )
+			report.bufferBytes += mCaptureNode->getQueue()->getStorageBytes();
+		
+		// Source dictionary, mapped when loaded from a binary cache:
+		if( mDictionary ) {
+			report.dictionaryEntries = mDictionary->size();
+			report.dictionaryBytes = mDictionary->getImageSize();
+			report.dictionaryMapped = mDictionary->isMapped();
+		}
+		
+		report.acousticModelBytes = MemoryReport::measureDirectory( mSettings.getHmm() );
+		if( ! mReady )
+			return report;
+		
+		report.acousticModelMapped = cmd_ln_boolean_r( mConfig, "-mmap" );
+		for( const auto& entry : mModelMap ) {
+			report.grammars.push_back( MemoryReport::measureGrammar( entry.first, static_cast<ModelFsg*>( entry.second.get() )->getModel() ) );
+			report.grammarBytes += report.grammars.back().bytes;
+		}
+		
+		report.rawDataBytes = mRawDataBytes;
+		report.latticeNodes = mLatticeNodes;
+		report.latticeLinks = mLatticeLinks;
+		return report;
+	}
+	
+	void Recognizer::decode(const int16_t* data, size_t size)
+	{
+		if( ! mReady )
+			throw std::runtime_error( "Could not decode audio: recognizer is not ready" );
+		
+		// Energy gate analyses float audio:
+		if( mGate ) {
+			if( mAnalysis.size() < size )
+				mAnalysis.resize( size );
+			SPHINX_TIMED_SCOPE( sConvertTimer );
+			convertInt16ToFloat( data, mAnalysis.data(), size );
+		}
+		
+		Trace::setSession( mTraceSession );
+		applyRecorder();
+		decodeBlock( data, size, mAnalysis.data() );
+	}
+	
+	void Recognizer::finish()
+	{
+		if( ! mDecoding )
+			return;
+		
+		if( mEndpointer.isInUtterance() )
+			endUtterance( false );
+		else
+			endUtteranceSilently();
+		mEndpointer.reset();
+		mDecoding = false;
+	}
+	
+	void Recognizer::discard()
+	{
+		if( ! mDecoding )
+			return;
+		
+		endUtteranceSilently();
+		if( mEndpointer.isInUtterance() )
+			mStats.recordDiscard();
+		mEndpointer.reset();
+		mPreRoll.clear();
+		mReplayPending = false;
+		startUtterance();
+	}
+	
+	void Recognizer::startRecording(const ci::fs::path& logPath)
+	{
+		// Open on calling thread, so errors reach the caller:
+		SessionRecorderRef recorder = SessionRecorder::create( logPath );
+		{
+			std::lock_guard<std::mutex> lock( mRecorderMutex );
+			mPendingRecorder = recorder;
+			mRecorderPending = true;
+		}
+		if( ! mThread.joinable() )
+			applyRecorder();
+	}
+	
+	void Recognizer::stopRecording()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mRecorderMutex );
+			mPendingRecorder.reset();
+			mRecorderPending = true;
+		}
+		if( ! mThread.joinable() )
+			applyRecorder();
+	}
+	
+	void Recognizer::applyRecorder()
+	{
+		if( ! mRecorderPending.load( std::memory_order_acquire ) )
+			return;
+		
+		SessionRecorderRef previous;
+		{
+			std::lock_guard<std::mutex> lock( mRecorderMutex );
+			previous = mRecorder;
+			mRecorder = mPendingRecorder;
+			mPendingRecorder.reset();
+			mRecorderPending = false;
+		}
+		
+		// Previous log closes when released here:
+		if( previous )
+			previous->flush();
+	}
+	
+	void Recognizer::replay(const ci::fs::path& logPath, bool paced)
+	{
+		if( ! mReady )
+			throw std::runtime_error( "Could not replay session: recognizer is not ready" );
+		if( mThread.joinable() )
+			throw std::runtime_error( "Could not replay session: recognizer is running" );
+		
+		SessionReaderRef reader = SessionReader::create( logPath );
+		SessionReader::Entry entry;
+		applyRecorder();
+		auto begin = std::chrono::steady_clock::now();
+		
+		// Drive decoder directly so it sees exactly the recorded input and boundaries:
+		finish();
+		while( reader->next( &entry ) ) {
+			if( paced )
+				std::this_thread::sleep_until( begin + std::chrono::microseconds( entry.timeUs ) );
 			
-			if( ! in_speech && utt_started ) {
-				// Start new utterance on speech to silence transition:
-				ps_end_utt( mDecoder );
-				
-				// Pass to handler:
-				if( mHandler )
-					mHandler->event( mDecoder );
+			switch( entry.type ) {
+				case SessionRecord::Start:
+					startUtterance();
+					mDecoding = true;
+					break;
+					
+				case SessionRecord::Audio:
+					if( mRecorder )
+						mRecorder->audio( entry.samples.data(), entry.samples.size() );
+					ps_process_raw( mDecoder, entry.samples.data(), entry.samples.size(), false, false );
+					mStats.recordSamples( entry.samples.size() );
+					break;
+					
+				case SessionRecord::End:
+					endUtterance( entry.value != 0 );
+					mDecoding = false;
+					break;
+					
+				case SessionRecord::Abort:
+					endUtteranceSilently();
+					mDecoding = false;
+					break;
+					
+				case SessionRecord::Search:
+					if( ps_set_search( mDecoder, entry.name.c_str() ) < 0 )
+						throw std::runtime_error( "Could not locate model \"" + entry.name + "\"" );
+					if( mRecorder )
+						mRecorder->search( entry.name.c_str() );
+					break;
+					
+				case SessionRecord::Reconfigure:
+					// Apply recorded pruning itself, so replay does not depend on this recognizer's shedding ladder:
+					if( ! reconfigure( entry.value, LoadShedder::apply( mSettings, entry.pruning ) ) || cmd_ln_int32_r( ps_get_config( mDecoder ), "-ds" ) != entry.pruning.ds )
+						throw std::runtime_error( "Could not replay session: load shedding level " + std::to_string( entry.value ) + " could not be applied" );
+					break;
+			}
+		}
+		
+		if( mDecoding ) {
+			endUtteranceSilently();
+			mDecoding = false;
+		}
+		mEndpointer.reset();
+		
+		// Replay bypasses the gate, so leave no withheld audio behind for live decoding:
+		mPreRoll.clear();
+		mReplayPending = false;
+	}
+	
+	void Recognizer::markDropped(size_t blocks, size_t samples)
+	{
+		mStats.recordDrop( blocks, samples );
+		SPHINX_COUNT( sDroppedCounter, samples );
+		mUttDropped += samples;
+	}
+	
+	bool Recognizer::gate(const float* analysis, const int16_t* data, size_t size)
+	{
+		if( ! mGate )
+			return true;
+		
+		bool wasOpen = mGate->isOpen();
+		
+		// Keep decoding through an utterance already in progress:
+		if( ! mGate->update( analysis, size ) && ! mEndpointer.isInUtterance() ) {
+			mGate->hold( size );
+			return false;
+		}
+		
+		// Replay audio withheld just before opening:
+		if( ! wasOpen )
+			mReplayPending = true;
+		
+		mGate->pass( size );
+		return true;
+	}
+	
+	void Recognizer::process(const int16_t* data, size_t size)
+	{
+		// Process buffer:
+		if( mRecorder ) {
+			mRecorder->search( ps_get_search( mDecoder ) );
+			mRecorder->audio( data, size );
+		}
+		{
+			SPHINX_TIMED_SCOPE( sProcessTimer );
+			auto processBegin = std::chrono::steady_clock::now();
+			ps_process_raw( mDecoder, data, size, false, false );
+			
+			// Track search time against audio time, excluding utterance delivery and reconfiguration:
+			if( mLoadShedder ) {
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - processBegin;
+				mLoadShedder->update( elapsed.count(), size / 16000.0 );
+			}
+		}
+		mStats.recordSamples( size );
+		
+		// Stream partial hypothesis at fixed audio intervals:
+		if( mResultRing && mPartialSamples > 0 && mEndpointer.isInUtterance() ) {
+			mSincePartial += size;
+			if( mSincePartial >= mPartialSamples ) {
+				mResultRing->publish( mDecoder, ResultRing::Kind::Partial, mTraceSession, mUttIndex );
+				mUttPartials = true;
+				mSincePartial = 0;
+			}
+		}
+		
+		bool in_speech = static_cast<bool>( ps_get_in_speech( mDecoder ) );
+		
+		Endpointer::Event event = mEndpointer.update( in_speech, size );
+		switch( event ) {
+			case Endpointer::Event::End:
+			case Endpointer::Event::Cut:
+				endUtterance( event == Endpointer::Event::Cut );
 				
 				// Prepare for next utterance:
-				if( ps_start_utt( mDecoder ) < 0 )
-					throw std::runtime_error( "Could not start utterance" );
+				startUtterance();
+				break;
+				
+			case Endpointer::Event::Discard:
+				// Drop utterance too short to be speech:
+				endUtteranceSilently();
+				mStats.recordDiscard();
+				startUtterance();
+				break;
 				
-				utt_started = false;
+			default:
+				break;
+		}
+		
+		// Adjust pruning between utterances, discarding the silence decoded so far:
+		size_t level;
+		if( ! mEndpointer.isInUtterance() && mLoadShedder && mLoadShedder->poll( &level ) ) {
+			endUtteranceSilently();
+			if( reconfigure( level, mLoadShedder->configure( mSettings, level ) ) )
+				startUtterance();
+			else
+				mDecoding = false;
+		}
+	}
+	
+	void Recognizer::endUtteranceSilently()
+	{
+		SPHINX_TIMED_SCOPE( sEndUttTimer );
+		ps_end_utt( mDecoder );
+		if( mRecorder )
+			mRecorder->abort();
+		measureBuffers();
+		
+		// Tell ring readers holding partials that no final follows:
+		if( mResultRing && mUttPartials )
+			mResultRing->publishDiscard( mTraceSession, mUttIndex );
+		mUttPartials = false;
+		mSincePartial = 0;
+	}
+	
+	void Recognizer::endUtterance(bool cut)
+	{
+		auto endBegin = std::chrono::steady_clock::now();
+		
+		// Finish utterance:
+		{
+			SPHINX_TIMED_SCOPE( sEndUttTimer );
+			ps_end_utt( mDecoder );
+		}
+		if( mRecorder )
+			mRecorder->end( cut );
+		if( mTrackLattices )
+			measureLattice();
+		measureBuffers();
+		
+		// Keep warm normalization state:
+		captureAdaptationState();
+		
+		// Record decoder timings and end-of-speech to dispatch latency:
+		double speech, cpu, wall;
+		ps_get_utt_time( mDecoder, &speech, &cpu, &wall );
+		std::chrono::duration<double,std::milli> latency = std::chrono::steady_clock::now() - endBegin;
+		mStats.recordUtterance( cut, ps_get_n_frames( mDecoder ), speech, cpu, wall, latency.count() );
+		ps_get_all_time( mDecoder, &speech, &cpu, &wall );
+		mStats.recordTotals( speech, cpu, wall );
+		
+		// Pass to handler:
+		if( mHandler ) {
+			SPHINX_TIMED_SCOPE( sHandlerTimer );
+			mHandler->event( mDecoder );
+		}
+		if( mResultSink )
+			mResultSink->publish( mDecoder, mTraceSession, mUttIndex, cut );
+		if( mResultRing )
+			mResultRing->publish( mDecoder, ResultRing::Kind::Final, mTraceSession, mUttIndex, cut );
+		mUttPartials = false;
+		mSincePartial = 0;
+	}
+	
+	void Recognizer::measureLattice()
+	{
+		size_t nodes = 0, links = 0;
+		ps_lattice_t* lattice = ps_get_lattice( mDecoder );
+		if( lattice ) {
+			for(ps_latnode_iter_t* nodeIter = ps_latnode_iter( lattice ); nodeIter; nodeIter = ps_latnode_iter_next( nodeIter )) {
+				nodes++;
+				for(ps_latlink_iter_t* linkIter = ps_latnode_exits( ps_latnode_iter_node( nodeIter ) ); linkIter; linkIter = ps_latlink_iter_next( linkIter ))
+					links++;
+			}
+		}
+		mLatticeNodes = nodes;
+		mLatticeLinks = links;
+	}
+	
+	void Recognizer::measureBuffers()
+	{
+		mBufferBytes = mEarlyAudio.capacity() * sizeof( int16_t ) + mPreRoll.getCapacity() * sizeof( int16_t ) + mAnalysis.capacity() * sizeof( float );
+		if( ! mReady )
+			return;
+		
+		// Raw audio kept by the decoder, sized by ps_set_rawdata_size:
+		int16* rawData = NULL;
+		int32 rawSize = 0;
+		ps_get_rawdata( mDecoder, &rawData, &rawSize );
+		mRawDataBytes = size_t( std::max( rawSize, int32( 0 ) ) ) * sizeof( int16 );
+	}
+	
+	bool Recognizer::reconfigure(size_t level, const RecognizerConfig& settings)
+	{
+		cmd_ln_t* config = settings.createCmdLn( ! mDictionary );
+		cmd_ln_t* current = ps_get_config( mDecoder );
+		
+		// Keep active search across re-registration:
+		const char* search = ps_get_search( mDecoder );
+		std::string activeSearch = search ? search : "";
+		
+		// Gaussian downsampling is fixed when the acoustic model loads, so only a -ds change needs reinitialization:
+		bool reinit = cmd_ln_int32_r( config, "-ds" ) != cmd_ln_int32_r( current, "-ds" );
+		if( reinit ) {
+			// Keep warm normalization state across reinitialization:
+			captureAdaptationState();
+			bool applied, restored = true;
+			{
+				std::lock_guard<std::mutex> lock( sDecoderInitMutex );
+				applied = ps_reinit( mDecoder, config ) >= 0;
+				// Fall back to the configuration in effect, keeping the current level:
+				if( ! applied )
+					restored = ps_reinit( mDecoder, mConfig ) >= 0;
+			}
+			if( applied ) {
+				cmd_ln_free_r( mConfig );
+				mConfig = config;
 			}
+			else {
+				cmd_ln_free_r( config );
+				E_ERROR( "Could not apply load shedding level %zu: decoder reinitialization failed\n", level );
+				if( mLoadShedder )
+					mLoadShedder->reject();
+				if( Trace::isEnabled() )
+					Trace::instant( "reconfigure_failed", std::to_string( level ).c_str() );
+				if( ! restored ) {
+					E_ERROR( "Could not restore decoder after failed reinitialization, stopping\n" );
+					mFailed = true;
+					return false;
+				}
+			}
+			mAdaptPending = true;
 			
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			// Re-register searches and the pruned dictionary's words, reloaded either way:
+			for( const auto& entry : mModelMap ) {
+				fsg_model_t* model = static_cast<ModelFsg*>( entry.second.get() )->getModel();
+				if( mDictionary )
+					addModelWords( model );
+				ps_set_fsg( mDecoder, entry.first.c_str(), model );
+			}
+			if( ! activeSearch.empty() )
+				ps_set_search( mDecoder, activeSearch.c_str() );
+			if( ! applied )
+				return true;
+		}
+		else {
+			// Searches read pruning from decoder config when created, so update it in place:
+			cmd_ln_set_float64_r( current, "-beam", cmd_ln_float64_r( config, "-beam" ) );
+			cmd_ln_set_float64_r( current, "-wbeam", cmd_ln_float64_r( config, "-wbeam" ) );
+			cmd_ln_set_int32_r( current, "-maxhmmpf", cmd_ln_int32_r( config, "-maxhmmpf" ) );
+			cmd_ln_free_r( config );
+			
+			// Re-register searches with new pruning:
+			for( const auto& entry : mModelMap )
+				ps_set_fsg( mDecoder, entry.first.c_str(), static_cast<ModelFsg*>( entry.second.get() )->getModel() );
+			if( ! activeSearch.empty() )
+				ps_set_search( mDecoder, activeSearch.c_str() );
+		}
+		
+		if( mLoadShedder )
+			mLoadShedder->commit( level );
+		if( mRecorder ) {
+			// Record resulting pruning, so replay reproduces it without the shedding ladder:
+			cmd_ln_t* applied = ps_get_config( mDecoder );
+			mRecorder->reconfigure( level, { cmd_ln_float64_r( applied, "-beam" ), cmd_ln_float64_r( applied, "-wbeam" ), int( cmd_ln_int32_r( applied, "-maxhmmpf" ) ), int( cmd_ln_int32_r( applied, "-ds" ) ) } );
+		}
+		if( Trace::isEnabled() )
+			Trace::instant( "reconfigure", std::to_string( level ).c_str() );
+		return true;
+	}
+	
+	void Recognizer::startUtterance()
+	{
+		// Apply loaded adaptation state between utterances:
+		if( mAdaptPending.exchange( false ) ) {
+			std::lock_guard<std::mutex> lock( mAdaptMutex );
+			feat_t* feat = ps_get_feat( mDecoder );
+			if( feat->cmn_struct && mCmnMean.size() == size_t( feat->cmn_struct->veclen ) )
+				cmn_prior_set( feat->cmn_struct, mCmnMean.data() );
+			if( feat->agc_struct )
+				agc_emax_set( feat->agc_struct, mAgcEmax );
+		}
+		
+		if( ps_start_utt( mDecoder ) < 0 )
+			throw std::runtime_error( "Could not start utterance" );
+		if( mRecorder )
+			mRecorder->start();
+		mUttDropped = 0;
+		mUttIndex = mUttStarted++;
+	}
+	
+	void Recognizer::captureAdaptationState()
+	{
+		std::lock_guard<std::mutex> lock( mAdaptMutex );
+		// Loaded state takes precedence until applied:
+		if( mAdaptPending )
+			return;
+		feat_t* feat = ps_get_feat( mDecoder );
+		if( feat->cmn_struct ) {
+			mCmnMean.resize( feat->cmn_struct->veclen );
+			cmn_prior_get( feat->cmn_struct, mCmnMean.data() );
+		}
+		if( feat->agc_struct )
+			mAgcEmax = agc_emax_get( feat->agc_struct );
+	}
+	
+	void Recognizer::setEndpointerFormat(const Endpointer::Format& format)
+	{
+		mEndpointer.setFormat( format );
+	}
+	
+	void Recognizer::setPreRoll(size_t ms)
+	{
+		mPreRoll.setCapacity( ms * 16000 / 1000 );
+	}
+	
+	void Recognizer::enableEnergyGate(const EnergyGate::Format& format)
+	{
+		mGate.reset( new EnergyGate( format ) );
+	}
+	
+	EnergyGate::Metrics Recognizer::getEnergyGateMetrics() const
+	{
+		if( mGate )
+			return mGate->getMetrics();
+		return EnergyGate::Metrics{ false, 0.0f, 0, 0 };
+	}
+	
+	void Recognizer::enableLoadShedding(const LoadShedder::Format& format, const LoadShedder::AdjustFn& adjustCb)
+	{
+		mLoadShedder.reset( new LoadShedder( format, adjustCb ) );
+	}
+	
+	LoadShedder::Metrics Recognizer::getLoadSheddingMetrics() const
+	{
+		if( mLoadShedder )
+			return mLoadShedder->getMetrics();
+		return LoadShedder::Metrics{ 0, 0.0, 0, 0, 0 };
+	}
+	
+	void Recognizer::saveAdaptationState(const ci::fs::path& statePath)
+	{
+		std::lock_guard<std::mutex> lock( mAdaptMutex );
+		
+		if( mCmnMean.empty() )
+			throw std::runtime_error( "Could not save adaptation state: no utterance has been decoded" );
+		
+		std::ofstream fh( statePath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not save adaptation state: \"" + statePath.string() + "\"" );
+		
+		// Same comma-separated layout as -cmninit:
+		fh << "cmn ";
+		for(size_t i = 0; i < mCmnMean.size(); i++)
+			fh << ( i > 0 ? "," : "" ) << MFCC2FLOAT( mCmnMean[ i ] );
+		fh << "\nagc " << mAgcEmax << "\n";
+	}
+	
+	void Recognizer::loadAdaptationState(const ci::fs::path& statePath)
+	{
+		std::ifstream fh( statePath.c_str() );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load adaptation state: \"" + statePath.string() + "\"" );
+		
+		std::vector<mfcc_t> cmnMean;
+		float agcEmax = 0.0f;
+		std::string key, value;
+		
+		try {
+			while( fh >> key >> value ) {
+				if( key == "cmn" ) {
+					std::stringstream ss( value );
+					std::string item;
+					while( std::getline( ss, item, ',' ) )
+						cmnMean.push_back( FLOAT2MFCC( std::stof( item ) ) );
+				}
+				else if( key == "agc" ) {
+					agcEmax = std::stof( value );
+				}
+			}
+		}
+		catch( const std::logic_error& ) {
+			cmnMean.clear();
 		}
+		
+		if( cmnMean.empty() )
+			throw std::runtime_error( "Could not parse adaptation state: \"" + statePath.string() + "\"" );
+		
+		std::lock_guard<std::mutex> lock( mAdaptMutex );
+		mCmnMean.swap( cmnMean );
+		mAgcEmax = agcEmax;
+		mAdaptPending = true;
 	}
 	
 	Recognizer::~Recognizer()
 	{
-		// Set stop flag:
+		// Wait for background initialization:
+		if( mInitThread.joinable() ) mInitThread.join();
+		// Set stop flag and wake runner:
 		mStop = true;
+		if( mSource ) mSource->interrupt();
 		// Join thread:
 		if( mThread.joinable() ) mThread.join();
 		// Cleanup decoder:
-		if( mDecoder ) ps_free( mDecoder );
+		if( mDecoder ) {
+			ps_free( mDecoder );
+			sLiveDecoders--;
+		}
 		// Cleanup config:
 		if( mConfig ) cmd_ln_free_r( mConfig );
 		// Cleanup models:
@@ -207,30 +1011,95 @@ namespace sphinx {
 	}
 	
 	void Recognizer::addModelJsgf(const std::string& key, const std::string& jsgfData, bool setActive)
+	{
+		whenReady( [this, key, jsgfData, setActive]() { addModelJsgfImpl( key, jsgfData, setActive ); } );
+	}
+	
+	void Recognizer::addModelJsgfImpl(const std::string& key, const std::string& jsgfData, bool setActive)
 	{
 		// Create model:
 		fsg_model_t* model = jsgf_read_string( jsgfData.c_str(), ps_get_logmath( mDecoder ), 7.5 );
 		// Verify model creation:
 		if( model == NULL )
 			throw std::runtime_error( "Could not parse JSGF model" );
+		// Extend pruned dictionary, if applicable:
+		if( mDictionary ) {
+			try {
+				addModelWords( model );
+			}
+			catch( ... ) {
+				fsg_model_free( model );
+				throw;
+			}
+		}
 		// Add entry:
 		mModelMap[ key ] = ModelRef( new ModelFsg( model ) );
 		// Add model to decoder:
 		ps_set_fsg( mDecoder, key.c_str(), model );
 		// Set active, if flagged:
-		if( setActive )
+		if( setActive ) {
 			ps_set_search( mDecoder, key.c_str() );
+			Trace::instant( "model_switch", key.c_str() );
+		}
+	}
+	
+	void Recognizer::addModelWords(fsg_model_t* model)
+	{
+		// Reload text source dictionary with only the words of models added so far:
+		if( ! mDictionary->isMapped() ) {
+			std::unordered_set<std::string> vocabulary( mVocabulary );
+			for(int32 i = 0; i < fsg_model_n_word( model ); i++)
+				vocabulary.insert( fsg_model_word_str( model, i ) );
+			if( vocabulary.size() > mVocabulary.size() ) {
+				mDictionary = Dictionary::create( mSettings.getDict(), vocabulary );
+				mVocabulary.swap( vocabulary );
+			}
+		}
+		
+		for(int32 i = 0; i < fsg_model_n_word( model ); i++) {
+			const char* word = fsg_model_word_str( model, i );
+			// Skip words already known to decoder, including fillers:
+			char* phones = ps_lookup_word( mDecoder, word );
+			if( phones != NULL ) {
+				ckd_free( phones );
+				continue;
+			}
+			// Add all pronunciations from source dictionary, alternates are numbered from two:
+			std::string entry;
+			char phoneStr[ 1024 ];
+			Pronunciation pron;
+			for(int alt = 1; ; alt++) {
+				entry.assign( word );
+				if( alt > 1 )
+					entry += "(" + std::to_string( alt ) + ")";
+				if( ! mDictionary->lookup( entry, &pron ) ) {
+					if( alt == 1 )
+						throw std::runtime_error( "Could not locate word \"" + std::string( word ) + "\" in dictionary" );
+					break;
+				}
+				if( pron.format( phoneStr, sizeof( phoneStr ) ) == 0 || ps_add_word( mDecoder, entry.c_str(), phoneStr, false ) < 0 )
+					throw std::runtime_error( "Could not add word \"" + entry + "\" to dictionary" );
+			}
+		}
+	}
+	
+	bool Recognizer::lookupWord(const std::string& word, Pronunciation* output) const
+	{
+		return mReady && mDictionary && mDictionary->lookup( word, output );
 	}
 	
 	void Recognizer::setActiveModel(const std::string& key)
 	{
-		// Look for existing entry:
-		auto findModel = mModelMap.find( key );
-		// Remove existing entry, if applicable:
-		if( findModel == mModelMap.end() )
-			throw std::runtime_error( "Could not locate model \"" + key + "\"" );
-		// Set model as cursor:
-		ps_set_search( mDecoder, key.c_str() );
+		whenReady( [this, key]() {
+			// Look for existing entry:
+			auto findModel = mModelMap.find( key );
+			// Remove existing entry, if applicable:
+			if( findModel == mModelMap.end() )
+				throw std::runtime_error( "Could not locate model \"" + key + "\"" );
+			// Set model as cursor:
+			ps_set_search( mDecoder, key.c_str() );
+			Trace::instant( "model_switch", key.c_str() );
+		} );
 	}
 	
 	void Recognizer::start()
@@ -239,14 +1108,38 @@ namespace sphinx {
 		auto ctx = ci::audio::Context::master();
 		// Create input node:
 		mInputNode = ctx->createInputDeviceNode();
-		// Create monitor node:
-		auto monitorFormat = ci::audio::MonitorNode::Format().windowSize( 1024 );
-		mMonitorNode = ctx->makeNode( new ci::audio::MonitorNode( monitorFormat ) );
-		// Attach monitor to input:
-		mInputNode >> mMonitorNode;
+		// Create capture node queuing every device block:
+		size_t blockFrames = ctx->getFramesPerBlock();
+		auto queueFormat = CaptureQueue::Format()
+			.sampleRate( ctx->getSampleRate() )
+			.channels( mInputNode->getNumChannels() )
+			.sampleType( AudioSource::SampleType::Float )
+			.blockFrames( blockFrames )
+			.capacity( mCaptureMs * ctx->getSampleRate() / 1000 / blockFrames )
+			.overflow( mCaptureOverflow );
+		mCaptureNode = ctx->makeNode( new CaptureNode( CaptureQueue::create( queueFormat ) ) );
+		// Attach capture to input:
+		mInputNode >> mCaptureNode;
 		// Enable audio input device and context:
 		mInputNode->enable();
 		ctx->enable();
+		// Read from capture queue:
+		start( mCaptureNode->getQueue() );
+	}
+	
+	void Recognizer::setCaptureOverflow(CaptureQueue::Overflow policy, size_t capacityMs)
+	{
+		if( policy == CaptureQueue::Overflow::Block )
+			throw std::runtime_error( "Could not set capture overflow: blocking would stall the audio thread" );
+		mCaptureOverflow = policy;
+		mCaptureMs = capacityMs;
+	}
+	
+	void Recognizer::start(const AudioSourceRef& source)
+	{
+		if( ! source )
+			throw std::runtime_error( "Could not start recognizer: audio source is null" );
+		mSource = source;
 		// Start runner thread:
 		mThread = std::thread( &Recognizer::run, this );
 	}
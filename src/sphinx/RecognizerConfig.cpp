@@ -0,0 +1,86 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/RecognizerConfig.hpp"
+
+#include <vector>
+#include <sstream>
+#include <limits>
+
+namespace sphinx {
+	
+	std::string RecognizerConfig::toArg(double value)
+	{
+		std::ostringstream ss;
+		ss.precision( std::numeric_limits<double>::max_digits10 );
+		ss << value;
+		return ss.str();
+	}
+	
+	RecognizerConfig& RecognizerConfig::preset(Preset value)
+	{
+		switch( value ) {
+			case Preset::LowLatency:
+				return beam( 1e-40 ).wbeam( 1e-24 ).maxhmmpf( 5000 ).ds( 1 ).topn( 2 ).plWindow( 0 );
+			case Preset::LowCpu:
+				return beam( 1e-30 ).wbeam( 1e-20 ).maxhmmpf( 1500 ).ds( 2 ).topn( 2 ).plWindow( 10 );
+			case Preset::HighAccuracy:
+				return beam( 1e-60 ).wbeam( 1e-40 ).maxhmmpf( 30000 ).ds( 1 ).topn( 8 ).plWindow( 0 );
+		}
+		return *this;
+	}
+	
+	cmd_ln_t* RecognizerConfig::createCmdLn(bool withDict) const
+	{
+		require( ! mHmmPath.empty(), "hmm path is required" );
+		require( ! mDictPath.empty(), "dict path is required" );
+		
+		// Collect arguments as owned strings:
+		std::vector<std::string> args = { "-hmm", mHmmPath.string() };
+		if( withDict ) {
+			args.push_back( "-dict" );
+			args.push_back( mDictPath.string() );
+		}
+		for( const auto& arg : mArgs ) {
+			// Log file is applied process-wide by recognizer, ps_init would swap and close the shared stream under running decoders:
+			if( arg.first == "-logfn" )
+				continue;
+			args.push_back( arg.first );
+			args.push_back( arg.second );
+		}
+		
+		std::vector<char*> argv;
+		for( auto& arg : args )
+			argv.push_back( &arg[ 0 ] );
+		
+		// Parse strictly so unknown names and malformed values are rejected:
+		cmd_ln_t* config = cmd_ln_parse_r( NULL, ps_args(), int32( argv.size() ), argv.data(), true );
+		
+		if( config == NULL )
+			throw std::runtime_error( "Could not configure speech recognizer" );
+		
+		return config;
+	}
+	
+} // namespace sphinx
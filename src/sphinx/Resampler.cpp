@@ -0,0 +1,296 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Resampler.hpp"
+#include "sphinx/AudioConvert.hpp"
+
+#include <cmath>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "cinder/audio/dsp/Converter.h"
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+	#include <xmmintrin.h>
+	#define SPHINX_RESAMPLER_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+	#include <arm_neon.h>
+	#define SPHINX_RESAMPLER_NEON
+#endif
+
+namespace sphinx {
+	
+	//! decoder sample rate
+	static const size_t kDestSampleRate = 16000;
+	
+	/** @brief dot product of Taps contiguous samples with filter, Taps is a multiple of four */
+	template<size_t Taps>
+	static inline float dot(const float* x, const float* h)
+	{
+#if defined( SPHINX_RESAMPLER_SSE )
+		__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+		size_t k = 0;
+		for(; k + 8 <= Taps; k += 8) {
+			acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( x + k ), _mm_load_ps( h + k ) ) );
+			acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( x + k + 4 ), _mm_load_ps( h + k + 4 ) ) );
+		}
+		if( k < Taps )
+			acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( x + k ), _mm_load_ps( h + k ) ) );
+		acc0 = _mm_add_ps( acc0, acc1 );
+		acc0 = _mm_add_ps( acc0, _mm_movehl_ps( acc0, acc0 ) );
+		acc0 = _mm_add_ss( acc0, _mm_shuffle_ps( acc0, acc0, 1 ) );
+		return _mm_cvtss_f32( acc0 );
+#elif defined( SPHINX_RESAMPLER_NEON )
+		float32x4_t acc = vdupq_n_f32( 0.0f );
+		for(size_t k = 0; k < Taps; k += 4)
+			acc = vmlaq_f32( acc, vld1q_f32( x + k ), vld1q_f32( h + k ) );
+		float32x2_t sum = vadd_f32( vget_low_f32( acc ), vget_high_f32( acc ) );
+		return vget_lane_f32( vpadd_f32( sum, sum ), 0 );
+#else
+		float acc[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for(size_t k = 0; k < Taps; k += 4)
+			for(size_t j = 0; j < 4; j++)
+				acc[ j ] += x[ k + j ] * h[ k + j ];
+		return ( acc[ 0 ] + acc[ 1 ] ) + ( acc[ 2 ] + acc[ 3 ] );
+#endif
+	}
+	
+	/** @brief saturating float to int16 conversion */
+	static inline int16_t toInt16(float sample)
+	{
+		return int16_t( std::max( -32768.0f, std::min( 32767.0f, sample * 32768.0f ) ) );
+	}
+	
+	/** @brief polyphase FIR decimator by integer factor, fusing downmix, filtering and int16 conversion */
+	template<size_t Factor, size_t Taps>
+	class ResamplerDecimator : public Resampler
+	{
+		static_assert( Taps % 4 == 0, "Tap count must be a multiple of four" );
+		
+	  private:
+		
+		size_t				mNumChannels;	//!< source channel count
+		size_t				mMaxFrames;		//!< source frames per block
+		alignas( 16 ) float	mFilter[ Taps ];	//!< lowpass filter, reversed
+		std::vector<float>	mHistory;		//!< filter history followed by current block
+		size_t				mNext;			//!< history index of next output sample
+		
+	  public:
+		
+		ResamplerDecimator(size_t numChannels, size_t maxFrames) :
+			mNumChannels( numChannels ),
+			mMaxFrames( maxFrames ),
+			mHistory( Taps - 1 + maxFrames, 0.0f ),
+			mNext( Taps - 1 )
+		{
+			// Blackman-windowed sinc with cutoff at 90% of destination Nyquist, unity DC gain:
+			const double pi = 3.14159265358979323846;
+			const double cutoff = 0.45 / Factor;
+			double sum = 0.0;
+			for(size_t k = 0; k < Taps; k++) {
+				double t = k - ( Taps - 1 ) / 2.0;
+				double sinc = t == 0.0 ? 2.0 * cutoff : sin( 2.0 * pi * cutoff * t ) / ( pi * t );
+				double window = 0.42 - 0.5 * cos( 2.0 * pi * k / ( Taps - 1 ) ) + 0.08 * cos( 4.0 * pi * k / ( Taps - 1 ) );
+				mFilter[ k ] = float( sinc * window );
+				sum += mFilter[ k ];
+			}
+			for(size_t k = 0; k < Taps; k++)
+				mFilter[ k ] = float( mFilter[ k ] / sum );
+			std::reverse( mFilter, mFilter + Taps );
+		}
+		
+		size_t process(const ci::audio::Buffer& input, int16_t* output, float* analysis)
+		{
+			float* block = mHistory.data() + Taps - 1;
+			const float gain = 1.0f / mNumChannels;
+			size_t count = 0;
+			
+			// Blocks longer than history are filtered in chunks:
+			for(size_t offset = 0; offset < input.getNumFrames(); offset += mMaxFrames) {
+				size_t numFrames = std::min( input.getNumFrames() - offset, mMaxFrames );
+				
+				// Downmix into history after previous chunk's tail:
+				memcpy( block, input.getChannel( 0 ) + offset, numFrames * sizeof( float ) );
+				for(size_t ch = 1; ch < mNumChannels; ch++) {
+					const float* channel = input.getChannel( ch ) + offset;
+					for(size_t i = 0; i < numFrames; i++)
+						block[ i ] += channel[ i ];
+				}
+				if( mNumChannels > 1 )
+					for(size_t i = 0; i < numFrames; i++)
+						block[ i ] *= gain;
+				
+				count += filter( numFrames, output + count, analysis ? analysis + count : NULL );
+			}
+			return count;
+		}
+		
+		size_t process(const float* input, size_t numFrames, int16_t* output, float* analysis)
+		{
+			size_t count = 0;
+			for(size_t offset = 0; offset < numFrames; offset += mMaxFrames) {
+				size_t chunk = std::min( numFrames - offset, mMaxFrames );
+				memcpy( mHistory.data() + Taps - 1, input + offset, chunk * sizeof( float ) );
+				count += filter( chunk, output + count, analysis ? analysis + count : NULL );
+			}
+			return count;
+		}
+		
+		/** @brief filters block already placed in history */
+		size_t filter(size_t numFrames, int16_t* output, float* analysis)
+		{
+			// Compute only the retained outputs:
+			size_t end = Taps - 1 + numFrames;
+			size_t count = 0;
+			for(; mNext < end; mNext += Factor) {
+				float sample = dot<Taps>( mHistory.data() + mNext + 1 - Taps, mFilter );
+				output[ count ] = toInt16( sample );
+				if( analysis )
+					analysis[ count ] = sample;
+				count++;
+			}
+			
+			// Keep tail for next block:
+			memmove( mHistory.data(), mHistory.data() + numFrames, ( Taps - 1 ) * sizeof( float ) );
+			mNext -= numFrames;
+			
+			return count;
+		}
+		
+		size_t getMaxOutputFrames() const { return mMaxFrames / Factor + 1; }
+		
+		bool isPolyphase() const { return true; }
+	};
+	
+	/** @brief downmix and int16 conversion for sources already at 16 kHz */
+	class ResamplerPassthrough : public Resampler
+	{
+	  private:
+		
+		size_t mMaxFrames;	//!< source frames per block
+		
+	  public:
+		
+		ResamplerPassthrough(size_t maxFrames) : mMaxFrames( maxFrames ) { /* no-op */ }
+		
+		size_t process(const ci::audio::Buffer& input, int16_t* output, float* analysis)
+		{
+			size_t numFrames = input.getNumFrames();
+			size_t numChannels = input.getNumChannels();
+			const float gain = 1.0f / numChannels;
+			for(size_t i = 0; i < numFrames; i++) {
+				float sample = input.getChannel( 0 )[ i ];
+				for(size_t ch = 1; ch < numChannels; ch++)
+					sample += input.getChannel( ch )[ i ];
+				sample *= gain;
+				output[ i ] = toInt16( sample );
+				if( analysis )
+					analysis[ i ] = sample;
+			}
+			return numFrames;
+		}
+		
+		size_t process(const float* input, size_t numFrames, int16_t* output, float* analysis)
+		{
+			for(size_t i = 0; i < numFrames; i++)
+				output[ i ] = toInt16( input[ i ] );
+			if( analysis )
+				memcpy( analysis, input, numFrames * sizeof( float ) );
+			return numFrames;
+		}
+		
+		size_t getMaxOutputFrames() const { return mMaxFrames; }
+		
+		bool isPolyphase() const { return false; }
+	};
+	
+	/** @brief generic Cinder converter for non-integer ratios */
+	class ResamplerConverter : public Resampler
+	{
+	  private:
+		
+		std::unique_ptr<ci::audio::dsp::Converter>	mConverter;		//!< generic sample rate converter
+		size_t										mMaxFrames;		//!< source frames per block
+		ci::audio::Buffer							mSourceBuffer;	//!< single channel input, allocated at max frames
+		ci::audio::Buffer							mDestBuffer;	//!< converted float audio
+		
+	  public:
+		
+		ResamplerConverter(size_t sourceSampleRate, size_t numChannels, size_t maxFrames) :
+			mConverter( ci::audio::dsp::Converter::create( sourceSampleRate, kDestSampleRate, numChannels, 1, maxFrames ) ),
+			mMaxFrames( maxFrames ),
+			mSourceBuffer( maxFrames, 1 ),
+			mDestBuffer( mConverter->getDestMaxFramesPerBlock(), mConverter->getDestNumChannels() )
+		{
+			/* no-op */
+		}
+		
+		size_t process(const ci::audio::Buffer& input, int16_t* output, float* analysis)
+		{
+			std::pair<size_t,size_t> convertResult = mConverter->convert( &input, &mDestBuffer );
+			convertFloatToInt16( mDestBuffer.getData(), output, convertResult.second );
+			if( analysis )
+				memcpy( analysis, mDestBuffer.getData(), convertResult.second * sizeof( float ) );
+			return convertResult.second;
+		}
+		
+		size_t process(const float* input, size_t numFrames, int16_t* output, float* analysis)
+		{
+			// Converter reads whole buffers, so shrink source buffer to each chunk, within its allocation:
+			size_t count = 0;
+			for(size_t offset = 0; offset < numFrames; offset += mMaxFrames) {
+				size_t chunk = std::min( numFrames - offset, mMaxFrames );
+				mSourceBuffer.setSize( chunk, 1 );
+				memcpy( mSourceBuffer.getData(), input + offset, chunk * sizeof( float ) );
+				count += process( mSourceBuffer, output + count, analysis ? analysis + count : NULL );
+			}
+			return count;
+		}
+		
+		size_t getMaxOutputFrames() const { return mConverter->getDestMaxFramesPerBlock(); }
+		
+		bool isPolyphase() const { return false; }
+	};
+	
+	ResamplerRef Resampler::create(size_t sourceSampleRate, size_t numChannels, size_t maxFramesPerBlock)
+	{
+		numChannels = std::max<size_t>( numChannels, 1 );
+		
+		// Sixteen taps per unit of decimation keeps the transition band constant at the destination rate:
+		switch( sourceSampleRate ) {
+			case kDestSampleRate:
+				return ResamplerRef( new ResamplerPassthrough( maxFramesPerBlock ) );
+			case kDestSampleRate * 2:
+				return ResamplerRef( new ResamplerDecimator<2, 32>( numChannels, maxFramesPerBlock ) );
+			case kDestSampleRate * 3:
+				return ResamplerRef( new ResamplerDecimator<3, 48>( numChannels, maxFramesPerBlock ) );
+			case kDestSampleRate * 6:
+				return ResamplerRef( new ResamplerDecimator<6, 96>( numChannels, maxFramesPerBlock ) );
+			default:
+				return ResamplerRef( new ResamplerConverter( sourceSampleRate, numChannels, maxFramesPerBlock ) );
+		}
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,417 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/ResultRing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined( __linux__ )
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace sphinx {
+	
+	static_assert( ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared-memory ring needs lock-free atomics" );
+	
+	//! ring identification
+	static const char kRingMagic[ 4 ] = { 'S', 'P', 'X', 'Q' };
+	static const uint32_t kRingVersion = 2;
+	
+	/** @brief shared header, one cache line of control state */
+	struct ResultRing::Header
+	{
+		char					magic[ 4 ];		//!< kRingMagic
+		uint32_t				version;		//!< kRingVersion
+		uint32_t				numSlots;		//!< slot count
+		uint32_t				slotBytes;		//!< bytes per slot, including slot header
+		std::atomic<uint64_t>	published;		//!< messages published
+		std::atomic<uint32_t>	futex;			//!< low bits of published, futex word
+		std::atomic<uint32_t>	waiters;		//!< readers blocked in futex wait
+		char					pad[ 32 ];		//!< keeps slots off the control line
+	};
+	
+	/** @brief per-slot header */
+	struct SlotHeader
+	{
+		std::atomic<uint64_t>	seq;			//!< 2n+1 while message n is written, 2n+2 once complete
+		uint32_t				bytes;			//!< record bytes
+		uint32_t				reserved;		//!< alignment
+	};
+	
+	/** @brief fixed part of a record */
+	struct RecordHeader
+	{
+		uint32_t		kind;			//!< ResultRing::Kind
+		uint32_t		session;		//!< recognizer session id
+		uint64_t		utterance;		//!< utterance index
+		uint64_t		timeUs;			//!< wall clock at publish
+		int32_t			score;			//!< best path score
+		float			confidence;		//!< utterance posterior
+		int32_t			frames;			//!< frames decoded
+		uint32_t		flags;			//!< kFlagCut, kFlagTruncated
+		uint32_t		textBytes;		//!< hypothesis bytes that follow, padded to 4
+		uint32_t		numSegments;	//!< segments that follow hypothesis
+	};
+	
+	/** @brief segment record, followed by its word padded to 4 bytes */
+	struct RecordSegment
+	{
+		int32_t			startFrame;		//!< first frame
+		int32_t			endFrame;		//!< last frame
+		int32_t			acousticScore;	//!< acoustic score
+		int32_t			languageScore;	//!< language score
+		float			confidence;		//!< posterior
+		uint32_t		wordBytes;		//!< word bytes that follow
+	};
+	
+	static const uint32_t kFlagCut = 1;
+	static const uint32_t kFlagTruncated = 2;
+	
+	// Slots follow the header back to back, so both sizes keep slot headers' 64-bit atomics aligned:
+	static_assert( sizeof( ResultRing::Header ) % alignof( SlotHeader ) == 0, "header must keep slots aligned" );
+	static_assert( sizeof( SlotHeader ) % alignof( RecordHeader ) == 0, "slot header must keep records aligned" );
+	
+	static size_t pad4(size_t bytes)
+	{
+		return ( bytes + 3 ) & ~size_t( 3 );
+	}
+	
+	static size_t padSlot(size_t bytes)
+	{
+		return ( bytes + alignof( SlotHeader ) - 1 ) & ~size_t( alignof( SlotHeader ) - 1 );
+	}
+	
+	static void futexWake(std::atomic<uint32_t>* word)
+	{
+#if defined( __linux__ )
+		syscall( SYS_futex, reinterpret_cast<uint32_t*>( word ), FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+#endif
+	}
+	
+	static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+	{
+#if defined( __linux__ )
+		struct timespec timeout = { timeoutMs / 1000, long( timeoutMs % 1000 ) * 1000000L };
+		syscall( SYS_futex, reinterpret_cast<uint32_t*>( word ), FUTEX_WAIT, expected, &timeout, NULL, 0 );
+#else
+		// No cross-process futex, poll instead:
+		auto begin = std::chrono::steady_clock::now();
+		while( word->load() == expected && std::chrono::steady_clock::now() - begin < std::chrono::milliseconds( timeoutMs ) )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+#endif
+	}
+	
+	ResultRing::ResultRing(const std::string& name, size_t numSlots, size_t slotBytes) :
+		mName( name ),
+		mFd( -1 ),
+		mHeader( NULL ),
+		mSlots( NULL ),
+		mMapSize( 0 ),
+		mNext( 0 )
+	{
+		numSlots = std::max<size_t>( numSlots, 1 );
+		slotBytes = padSlot( std::max( slotBytes, sizeof( SlotHeader ) + sizeof( RecordHeader ) + 64 ) );
+		mMapSize = sizeof( Header ) + numSlots * slotBytes;
+		
+		// Replace any stale object left by a crashed writer:
+		shm_unlink( name.c_str() );
+		mFd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+		if( mFd < 0 )
+			throw std::runtime_error( "Could not create shared memory \"" + name + "\"" );
+		void* map = MAP_FAILED;
+		if( ftruncate( mFd, off_t( mMapSize ) ) == 0 )
+			map = mmap( NULL, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0 );
+		if( map == MAP_FAILED ) {
+			close( mFd );
+			shm_unlink( name.c_str() );
+			throw std::runtime_error( "Could not map shared memory \"" + name + "\"" );
+		}
+		
+		// Fresh pages are zeroed, so every slot sequence starts empty:
+		mHeader = new( map ) Header();
+		memcpy( mHeader->magic, kRingMagic, sizeof( kRingMagic ) );
+		mHeader->version = kRingVersion;
+		mHeader->numSlots = uint32_t( numSlots );
+		mHeader->slotBytes = uint32_t( slotBytes );
+		mHeader->published = 0;
+		mHeader->futex = 0;
+		mHeader->waiters = 0;
+		mSlots = static_cast<char*>( map ) + sizeof( Header );
+	}
+	
+	ResultRing::~ResultRing()
+	{
+		munmap( mHeader, mMapSize );
+		close( mFd );
+		shm_unlink( mName.c_str() );
+	}
+	
+	char* ResultRing::beginSlot(uint64_t sequence, size_t* capacity)
+	{
+		SlotHeader* slot = reinterpret_cast<SlotHeader*>( mSlots + ( sequence % mHeader->numSlots ) * mHeader->slotBytes );
+		slot->seq.store( 2 * sequence + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+		*capacity = mHeader->slotBytes - sizeof( SlotHeader );
+		return reinterpret_cast<char*>( slot + 1 );
+	}
+	
+	void ResultRing::endSlot(uint64_t sequence, size_t bytes)
+	{
+		SlotHeader* slot = reinterpret_cast<SlotHeader*>( mSlots + ( sequence % mHeader->numSlots ) * mHeader->slotBytes );
+		slot->bytes = uint32_t( bytes );
+		slot->seq.store( 2 * sequence + 2, std::memory_order_release );
+		mHeader->published.store( sequence + 1 );
+		mHeader->futex.store( uint32_t( sequence + 1 ) );
+		
+		// Only pay for a syscall when a reader is asleep:
+		if( mHeader->waiters.load() > 0 )
+			futexWake( &mHeader->futex );
+	}
+	
+	void ResultRing::publish(ps_decoder_t* decoder, Kind kind, uint32_t session, uint64_t utterance, bool cut)
+	{
+		uint64_t sequence = mNext++;
+		size_t capacity;
+		char* data = beginSlot( sequence, &capacity );
+		
+		int32 score = 0;
+		const char* hyp = ps_get_hyp( decoder, &score );
+		size_t hypBytes = hyp ? strlen( hyp ) : 0;
+		
+		RecordHeader* record = reinterpret_cast<RecordHeader*>( data );
+		record->kind = uint32_t( kind );
+		record->session = session;
+		record->utterance = utterance;
+		record->timeUs = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+		record->score = score;
+		record->confidence = kind == Kind::Final ? float( logmath_exp( ps_get_logmath( decoder ), ps_get_prob( decoder ) ) ) : 0.0f;
+		record->frames = ps_get_n_frames( decoder );
+		record->flags = cut ? kFlagCut : 0;
+		record->numSegments = 0;
+		
+		// Hypothesis, truncated to slot:
+		size_t offset = sizeof( RecordHeader );
+		if( offset + pad4( hypBytes ) > capacity ) {
+			hypBytes = ( capacity - offset ) & ~size_t( 3 );
+			record->flags |= kFlagTruncated;
+		}
+		record->textBytes = uint32_t( hypBytes );
+		if( hypBytes > 0 )
+			memcpy( data + offset, hyp, hypBytes );
+		offset += pad4( hypBytes );
+		
+		// Segments of final results, written in place while they fit:
+		if( kind == Kind::Final ) {
+			logmath_t* logmath = ps_get_logmath( decoder );
+			for(ps_seg_t* iter = ps_seg_iter( decoder, NULL ); iter; iter = ps_seg_next( iter )) {
+				const char* word = ps_seg_word( iter );
+				size_t wordBytes = strlen( word );
+				if( offset + sizeof( RecordSegment ) + pad4( wordBytes ) > capacity ) {
+					record->flags |= kFlagTruncated;
+					ps_seg_free( iter );
+					break;
+				}
+				RecordSegment* seg = reinterpret_cast<RecordSegment*>( data + offset );
+				int startFrame, endFrame;
+				int32 ascr, lscr, lback;
+				ps_seg_frames( iter, &startFrame, &endFrame );
+				seg->confidence = float( logmath_exp( logmath, ps_seg_prob( iter, &ascr, &lscr, &lback ) ) );
+				seg->startFrame = startFrame;
+				seg->endFrame = endFrame;
+				seg->acousticScore = ascr;
+				seg->languageScore = lscr;
+				seg->wordBytes = uint32_t( wordBytes );
+				memcpy( data + offset + sizeof( RecordSegment ), word, wordBytes );
+				offset += sizeof( RecordSegment ) + pad4( wordBytes );
+				record->numSegments++;
+			}
+		}
+		
+		endSlot( sequence, offset );
+	}
+	
+	void ResultRing::publishDiscard(uint32_t session, uint64_t utterance)
+	{
+		uint64_t sequence = mNext++;
+		size_t capacity;
+		RecordHeader* record = reinterpret_cast<RecordHeader*>( beginSlot( sequence, &capacity ) );
+		record->kind = uint32_t( Kind::Discard );
+		record->session = session;
+		record->utterance = utterance;
+		record->timeUs = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+		record->score = 0;
+		record->confidence = 0.0f;
+		record->frames = 0;
+		record->flags = 0;
+		record->textBytes = 0;
+		record->numSegments = 0;
+		endSlot( sequence, sizeof( RecordHeader ) );
+	}
+	
+	ResultRingReader::ResultRingReader(const std::string& name, bool fromStart) :
+		mFd( -1 ),
+		mHeader( NULL ),
+		mSlots( NULL ),
+		mMapSize( 0 ),
+		mNext( 0 ),
+		mLost( 0 )
+	{
+		// Readers map read-write to register as futex waiters:
+		mFd = shm_open( name.c_str(), O_RDWR, 0 );
+		if( mFd < 0 )
+			throw std::runtime_error( "Could not open shared memory \"" + name + "\"" );
+		struct stat info;
+		void* map = MAP_FAILED;
+		if( fstat( mFd, &info ) == 0 && size_t( info.st_size ) >= sizeof( ResultRing::Header ) ) {
+			mMapSize = size_t( info.st_size );
+			map = mmap( NULL, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0 );
+		}
+		if( map == MAP_FAILED ) {
+			close( mFd );
+			throw std::runtime_error( "Could not map shared memory \"" + name + "\"" );
+		}
+		mHeader = static_cast<ResultRing::Header*>( map );
+		mSlots = static_cast<const char*>( map ) + sizeof( ResultRing::Header );
+		
+		// Slot size must keep slot headers aligned and fit a record header, as the writer guarantees:
+		if( memcmp( mHeader->magic, kRingMagic, sizeof( kRingMagic ) ) != 0 || mHeader->version != kRingVersion || mHeader->numSlots == 0
+		   || mHeader->slotBytes % alignof( SlotHeader ) != 0 || mHeader->slotBytes < sizeof( SlotHeader ) + sizeof( RecordHeader )
+		   || sizeof( ResultRing::Header ) + size_t( mHeader->numSlots ) * mHeader->slotBytes > mMapSize ) {
+			munmap( map, mMapSize );
+			close( mFd );
+			throw std::runtime_error( "Could not read shared memory \"" + name + "\": not a result ring" );
+		}
+		
+		uint64_t published = mHeader->published.load();
+		mNext = fromStart && published > mHeader->numSlots ? published - mHeader->numSlots : ( fromStart ? 0 : published );
+		mBuffer.resize( mHeader->slotBytes );
+	}
+	
+	ResultRingReader::~ResultRingReader()
+	{
+		munmap( mHeader, mMapSize );
+		close( mFd );
+	}
+	
+	bool ResultRingReader::poll(Message* output)
+	{
+		const uint32_t numSlots = mHeader->numSlots;
+		const uint32_t slotBytes = mHeader->slotBytes;
+		
+		while( true ) {
+			uint64_t published = mHeader->published.load( std::memory_order_acquire );
+			if( mNext >= published )
+				return false;
+			
+			// Skip what the writer has already overwritten:
+			if( published - mNext > numSlots ) {
+				mLost += published - numSlots - mNext;
+				mNext = published - numSlots;
+			}
+			
+			const SlotHeader* slot = reinterpret_cast<const SlotHeader*>( mSlots + ( mNext % numSlots ) * slotBytes );
+			uint64_t expected = 2 * mNext + 2;
+			uint64_t before = slot->seq.load( std::memory_order_acquire );
+			size_t bytes = std::min<size_t>( slot->bytes, slotBytes - sizeof( SlotHeader ) );
+			memcpy( mBuffer.data(), slot + 1, bytes );
+			std::atomic_thread_fence( std::memory_order_acquire );
+			uint64_t after = slot->seq.load( std::memory_order_relaxed );
+			if( before != expected || after != expected ) {
+				// Lapped while copying:
+				mLost++;
+				mNext++;
+				continue;
+			}
+			
+			// Decode copy:
+			const char* data = mBuffer.data();
+			const RecordHeader* record = reinterpret_cast<const RecordHeader*>( data );
+			output->kind = ResultRing::Kind( record->kind );
+			output->sequence = mNext;
+			output->session = record->session;
+			output->utterance = record->utterance;
+			output->timeUs = record->timeUs;
+			output->score = record->score;
+			output->confidence = record->confidence;
+			output->frames = record->frames;
+			output->cut = ( record->flags & kFlagCut ) != 0;
+			output->truncated = ( record->flags & kFlagTruncated ) != 0;
+			size_t offset = sizeof( RecordHeader );
+			output->hypothesis.assign( data + offset, std::min<size_t>( record->textBytes, bytes - std::min( bytes, offset ) ) );
+			offset += pad4( record->textBytes );
+			
+			output->numSegments = 0;
+			for(uint32_t i = 0; i < record->numSegments && offset + sizeof( RecordSegment ) <= bytes; i++) {
+				const RecordSegment* seg = reinterpret_cast<const RecordSegment*>( data + offset );
+				offset += sizeof( RecordSegment );
+				if( output->numSegments == output->segments.size() )
+					output->segments.emplace_back();
+				ResultSink::Segment& out = output->segments[ output->numSegments++ ];
+				out.word.assign( data + offset, std::min<size_t>( seg->wordBytes, bytes - std::min( bytes, offset ) ) );
+				out.startFrame = seg->startFrame;
+				out.endFrame = seg->endFrame;
+				out.acousticScore = seg->acousticScore;
+				out.languageScore = seg->languageScore;
+				out.confidence = seg->confidence;
+				offset += pad4( seg->wordBytes );
+			}
+			
+			mNext++;
+			return true;
+		}
+	}
+	
+	bool ResultRingReader::wait(Message* output, int timeoutMs)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeoutMs );
+		while( true ) {
+			if( poll( output ) )
+				return true;
+			
+			int remaining = int( std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now() ).count() );
+			if( remaining <= 0 )
+				return false;
+			
+			// Register before rechecking so a publish in between either is seen or wakes us:
+			uint32_t seen = mHeader->futex.load();
+			mHeader->waiters++;
+			if( mHeader->published.load() <= mNext )
+				futexWait( &mHeader->futex, seen, remaining );
+			mHeader->waiters--;
+		}
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,306 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/ResultSink.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+namespace sphinx {
+	
+	//! binary record version
+	static const uint8_t kBinaryVersion = 1;
+	
+	//! writes whole buffer to descriptor, retrying partial and interrupted writes
+	static bool writeAll(int fd, const char* data, size_t size)
+	{
+		while( size > 0 ) {
+			ssize_t written = ::write( fd, data, size );
+			if( written < 0 ) {
+				if( errno == EINTR )
+					continue;
+				return false;
+			}
+			data += written;
+			size -= size_t( written );
+		}
+		return true;
+	}
+	
+	ResultSink::ResultSink(size_t capacity) :
+		mSlots( capacity > 0 ? capacity : 1 ),
+		mHead( 0 ),
+		mTail( 0 ),
+		mDropped( 0 ),
+		mStop( false )
+	{
+		/* no-op */
+	}
+	
+	ResultSink::~ResultSink()
+	{
+		stop();
+	}
+	
+	void ResultSink::start()
+	{
+		mThread = std::thread( &ResultSink::run, this );
+	}
+	
+	void ResultSink::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mStop = true;
+		}
+		mCv.notify_all();
+		if( mThread.joinable() )
+			mThread.join();
+	}
+	
+	void ResultSink::publish(ps_decoder_t* decoder, uint32_t session, uint64_t utterance, bool cut)
+	{
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			if( mHead - mTail >= mSlots.size() ) {
+				mDropped++;
+				return;
+			}
+		}
+		
+		// Slot at head belongs to this thread until published, strings and segments keep their capacity:
+		Result& r = mSlots[ mHead % mSlots.size() ];
+		logmath_t* logmath = ps_get_logmath( decoder );
+		r.session = session;
+		r.utterance = utterance;
+		r.timeUs = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+		r.cut = cut;
+		int32 score = 0;
+		const char* hyp = ps_get_hyp( decoder, &score );
+		r.hypothesis.assign( hyp ? hyp : "" );
+		r.score = score;
+		r.confidence = float( logmath_exp( logmath, ps_get_prob( decoder ) ) );
+		r.frames = ps_get_n_frames( decoder );
+		ps_get_utt_time( decoder, &r.speechSeconds, &r.cpuSeconds, &r.wallSeconds );
+		
+		r.numSegments = 0;
+		for(ps_seg_t* iter = ps_seg_iter( decoder, NULL ); iter; iter = ps_seg_next( iter )) {
+			if( r.numSegments == r.segments.size() )
+				r.segments.emplace_back();
+			Segment& seg = r.segments[ r.numSegments++ ];
+			int startFrame, endFrame;
+			int32 ascr, lscr, lback;
+			ps_seg_frames( iter, &startFrame, &endFrame );
+			int32 prob = ps_seg_prob( iter, &ascr, &lscr, &lback );
+			seg.word.assign( ps_seg_word( iter ) );
+			seg.startFrame = startFrame;
+			seg.endFrame = endFrame;
+			seg.acousticScore = ascr;
+			seg.languageScore = lscr;
+			seg.confidence = float( logmath_exp( logmath, prob ) );
+		}
+		
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mHead++;
+		}
+		mCv.notify_one();
+	}
+	
+	void ResultSink::run()
+	{
+		while( true ) {
+			{
+				std::unique_lock<std::mutex> lock( mMutex );
+				mCv.wait( lock, [this]() { return mStop || mTail != mHead; } );
+				// Drain before stopping:
+				if( mTail == mHead )
+					return;
+			}
+			
+			consume( mSlots[ mTail % mSlots.size() ] );
+			
+			std::lock_guard<std::mutex> lock( mMutex );
+			mTail++;
+		}
+	}
+	
+	//! appends JSON string literal
+	static void appendJsonString(std::string* out, const std::string& str)
+	{
+		out->push_back( '"' );
+		for( char c : str ) {
+			if( c == '"' || c == '\\' ) {
+				out->push_back( '\\' );
+				out->push_back( c );
+			}
+			else if( (unsigned char)( c ) < 0x20 ) {
+				char escaped[ 8 ];
+				snprintf( escaped, sizeof( escaped ), "\\u%04x", (unsigned)( c ) );
+				out->append( escaped );
+			}
+			else {
+				out->push_back( c );
+			}
+		}
+		out->push_back( '"' );
+	}
+	
+	//! appends formatted text
+	template<typename... Args>
+	static void appendFormat(std::string* out, const char* format, Args... args)
+	{
+		char text[ 128 ];
+		int length = snprintf( text, sizeof( text ), format, args... );
+		if( length > 0 )
+			out->append( text, std::min( size_t( length ), sizeof( text ) - 1 ) );
+	}
+	
+	ResultSinkJson::ResultSinkJson(int fd, bool ownsFd, size_t capacity) :
+		ResultSink( capacity ),
+		mFd( fd ),
+		mOwnsFd( ownsFd ),
+		mErrors( 0 )
+	{
+		mBuffer.reserve( 4096 );
+		start();
+	}
+	
+	ResultSinkJson::~ResultSinkJson()
+	{
+		stop();
+		if( mOwnsFd )
+			::close( mFd );
+	}
+	
+	void ResultSinkJson::consume(const Result& r)
+	{
+		mBuffer.clear();
+		appendFormat( &mBuffer, "{\"session\":%u,\"utterance\":%llu,\"time_us\":%llu,\"cut\":%s,\"hypothesis\":", r.session, (unsigned long long)r.utterance, (unsigned long long)r.timeUs, r.cut ? "true" : "false" );
+		appendJsonString( &mBuffer, r.hypothesis );
+		appendFormat( &mBuffer, ",\"score\":%d,\"confidence\":%.6g,\"frames\":%d,\"speech_s\":%.6g,\"cpu_s\":%.6g,\"wall_s\":%.6g,\"segments\":[", r.score, r.confidence, r.frames, r.speechSeconds, r.cpuSeconds, r.wallSeconds );
+		for(size_t i = 0; i < r.numSegments; i++) {
+			const Segment& seg = r.segments[ i ];
+			mBuffer.append( i > 0 ? ",{\"word\":" : "{\"word\":" );
+			appendJsonString( &mBuffer, seg.word );
+			appendFormat( &mBuffer, ",\"start\":%d,\"end\":%d,\"ascr\":%d,\"lscr\":%d,\"confidence\":%.6g}", seg.startFrame, seg.endFrame, seg.acousticScore, seg.languageScore, seg.confidence );
+		}
+		mBuffer.append( "]}\n" );
+		
+		if( ! writeAll( mFd, mBuffer.data(), mBuffer.size() ) )
+			mErrors++;
+	}
+	
+	//! appends little-endian integer
+	template<typename T>
+	static void appendLe(std::vector<char>* out, T value)
+	{
+		for(size_t i = 0; i < sizeof( T ); i++)
+			out->push_back( char( ( uint64_t( value ) >> ( 8 * i ) ) & 0xff ) );
+	}
+	
+	//! appends little-endian float
+	static void appendLe(std::vector<char>* out, float value)
+	{
+		uint32_t bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+		appendLe( out, bits );
+	}
+	
+	//! appends little-endian double
+	static void appendLe(std::vector<char>* out, double value)
+	{
+		uint64_t bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+		appendLe( out, bits );
+	}
+	
+	//! appends uint16 length and bytes, truncated to 65535 bytes
+	static void appendString(std::vector<char>* out, const std::string& str)
+	{
+		uint16_t length = uint16_t( std::min<size_t>( str.size(), 0xffff ) );
+		appendLe( out, length );
+		out->insert( out->end(), str.data(), str.data() + length );
+	}
+	
+	ResultSinkBinary::ResultSinkBinary(int fd, bool ownsFd, size_t capacity) :
+		ResultSink( capacity ),
+		mFd( fd ),
+		mOwnsFd( ownsFd ),
+		mErrors( 0 )
+	{
+		mBuffer.reserve( 4096 );
+		start();
+	}
+	
+	ResultSinkBinary::~ResultSinkBinary()
+	{
+		stop();
+		if( mOwnsFd )
+			::close( mFd );
+	}
+	
+	void ResultSinkBinary::consume(const Result& r)
+	{
+		// Reserve length prefix, filled once record is complete:
+		mBuffer.assign( sizeof( uint32_t ), 0 );
+		appendLe( &mBuffer, kBinaryVersion );
+		appendLe( &mBuffer, r.session );
+		appendLe( &mBuffer, r.utterance );
+		appendLe( &mBuffer, r.timeUs );
+		appendLe( &mBuffer, uint8_t( r.cut ? 1 : 0 ) );
+		appendLe( &mBuffer, r.score );
+		appendLe( &mBuffer, r.confidence );
+		appendLe( &mBuffer, r.frames );
+		appendLe( &mBuffer, r.speechSeconds );
+		appendLe( &mBuffer, r.cpuSeconds );
+		appendLe( &mBuffer, r.wallSeconds );
+		appendString( &mBuffer, r.hypothesis );
+		
+		uint16_t numSegments = uint16_t( std::min<size_t>( r.numSegments, 0xffff ) );
+		appendLe( &mBuffer, numSegments );
+		for(size_t i = 0; i < numSegments; i++) {
+			const Segment& seg = r.segments[ i ];
+			appendString( &mBuffer, seg.word );
+			appendLe( &mBuffer, seg.startFrame );
+			appendLe( &mBuffer, seg.endFrame );
+			appendLe( &mBuffer, seg.acousticScore );
+			appendLe( &mBuffer, seg.languageScore );
+			appendLe( &mBuffer, seg.confidence );
+		}
+		
+		uint32_t length = uint32_t( mBuffer.size() - sizeof( uint32_t ) );
+		for(size_t i = 0; i < sizeof( length ); i++)
+			mBuffer[ i ] = char( ( length >> ( 8 * i ) ) & 0xff );
+		
+		if( ! writeAll( mFd, mBuffer.data(), mBuffer.size() ) )
+			mErrors++;
+	}
+	
+} // namespace sphinx
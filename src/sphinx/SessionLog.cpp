@@ -0,0 +1,192 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/SessionLog.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace sphinx {
+	
+	//! log file magic
+	static const char kSessionMagic[ 4 ] = { 'S', 'P', 'X', 'R' };
+	
+	//! log format version
+	static const uint32_t kSessionVersion = 2;
+	
+	SessionRecorder::SessionRecorder(const ci::fs::path& logPath) :
+		mFile( logPath.c_str(), std::ios::binary | std::ios::trunc ),
+		mBegin( std::chrono::steady_clock::now() )
+	{
+		if( ! mFile.is_open() )
+			throw std::runtime_error( "Could not write session log: \"" + logPath.string() + "\"" );
+		
+		// Header, integers in host byte order:
+		uint32_t sampleRate = 16000;
+		mFile.write( kSessionMagic, sizeof( kSessionMagic ) );
+		mFile.write( reinterpret_cast<const char*>( &kSessionVersion ), sizeof( kSessionVersion ) );
+		mFile.write( reinterpret_cast<const char*>( &sampleRate ), sizeof( sampleRate ) );
+	}
+	
+	void SessionRecorder::header(SessionRecord type)
+	{
+		uint64_t timeUs = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - mBegin ).count();
+		mFile.put( char( type ) );
+		mFile.write( reinterpret_cast<const char*>( &timeUs ), sizeof( timeUs ) );
+	}
+	
+	void SessionRecorder::start()
+	{
+		header( SessionRecord::Start );
+	}
+	
+	void SessionRecorder::audio(const int16_t* data, size_t size)
+	{
+		uint32_t count = uint32_t( size );
+		header( SessionRecord::Audio );
+		mFile.write( reinterpret_cast<const char*>( &count ), sizeof( count ) );
+		mFile.write( reinterpret_cast<const char*>( data ), count * sizeof( int16_t ) );
+	}
+	
+	void SessionRecorder::end(bool cut)
+	{
+		header( SessionRecord::End );
+		mFile.put( cut ? 1 : 0 );
+	}
+	
+	void SessionRecorder::abort()
+	{
+		header( SessionRecord::Abort );
+	}
+	
+	void SessionRecorder::search(const char* name)
+	{
+		if( ! name || mSearch == name )
+			return;
+		mSearch = name;
+		
+		uint16_t length = uint16_t( std::min<size_t>( mSearch.size(), 0xFFFF ) );
+		header( SessionRecord::Search );
+		mFile.write( reinterpret_cast<const char*>( &length ), sizeof( length ) );
+		mFile.write( mSearch.data(), length );
+	}
+	
+	void SessionRecorder::reconfigure(size_t level, const LoadShedder::Level& pruning)
+	{
+		uint32_t value = uint32_t( level );
+		int32_t maxhmmpf = int32_t( pruning.maxhmmpf ), ds = int32_t( pruning.ds );
+		header( SessionRecord::Reconfigure );
+		mFile.write( reinterpret_cast<const char*>( &value ), sizeof( value ) );
+		mFile.write( reinterpret_cast<const char*>( &pruning.beam ), sizeof( pruning.beam ) );
+		mFile.write( reinterpret_cast<const char*>( &pruning.wbeam ), sizeof( pruning.wbeam ) );
+		mFile.write( reinterpret_cast<const char*>( &maxhmmpf ), sizeof( maxhmmpf ) );
+		mFile.write( reinterpret_cast<const char*>( &ds ), sizeof( ds ) );
+	}
+	
+	SessionReader::SessionReader(const ci::fs::path& logPath) :
+		mPos( 0 )
+	{
+		std::ifstream fh( logPath.c_str(), std::ios::binary );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not read session log: \"" + logPath.string() + "\"" );
+		mData.assign( ( std::istreambuf_iterator<char>( fh ) ), std::istreambuf_iterator<char>() );
+		
+		char magic[ 4 ];
+		uint32_t version, sampleRate;
+		take( magic, sizeof( magic ) );
+		take( &version, sizeof( version ) );
+		take( &sampleRate, sizeof( sampleRate ) );
+		if( memcmp( magic, kSessionMagic, sizeof( magic ) ) != 0 || version != kSessionVersion || sampleRate != 16000 )
+			throw std::runtime_error( "Could not read session log: \"" + logPath.string() + "\" is not a supported session log" );
+	}
+	
+	void SessionReader::take(void* dest, size_t size)
+	{
+		if( mPos + size > mData.size() )
+			throw std::runtime_error( "Could not read session log: log is truncated" );
+		memcpy( dest, mData.data() + mPos, size );
+		mPos += size;
+	}
+	
+	bool SessionReader::next(Entry* entry)
+	{
+		if( mPos >= mData.size() )
+			return false;
+		
+		uint8_t type;
+		take( &type, sizeof( type ) );
+		take( &entry->timeUs, sizeof( entry->timeUs ) );
+		entry->type = SessionRecord( type );
+		entry->value = 0;
+		
+		switch( entry->type ) {
+			case SessionRecord::Start:
+			case SessionRecord::Abort:
+				break;
+				
+			case SessionRecord::Audio: {
+				uint32_t count;
+				take( &count, sizeof( count ) );
+				entry->samples.resize( count );
+				take( entry->samples.data(), count * sizeof( int16_t ) );
+				break;
+			}
+				
+			case SessionRecord::End: {
+				uint8_t cut;
+				take( &cut, sizeof( cut ) );
+				entry->value = cut;
+				break;
+			}
+				
+			case SessionRecord::Search: {
+				uint16_t length;
+				take( &length, sizeof( length ) );
+				entry->name.resize( length );
+				take( &entry->name[ 0 ], length );
+				break;
+			}
+				
+			case SessionRecord::Reconfigure: {
+				int32_t maxhmmpf, ds;
+				take( &entry->value, sizeof( entry->value ) );
+				take( &entry->pruning.beam, sizeof( entry->pruning.beam ) );
+				take( &entry->pruning.wbeam, sizeof( entry->pruning.wbeam ) );
+				take( &maxhmmpf, sizeof( maxhmmpf ) );
+				take( &ds, sizeof( ds ) );
+				entry->pruning.maxhmmpf = maxhmmpf;
+				entry->pruning.ds = ds;
+				break;
+			}
+				
+			default:
+				throw std::runtime_error( "Could not read session log: unknown record type" );
+		}
+		
+		return true;
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,156 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Stats.hpp"
+
+#include <algorithm>
+
+namespace sphinx {
+	
+	Stats::Histogram::Histogram(const std::vector<double>& bounds) :
+		mBounds( bounds ),
+		mCounts( new std::atomic<uint64_t>[ bounds.size() + 1 ] ),
+		mCount( 0 ),
+		mSum( 0.0 )
+	{
+		for(size_t i = 0; i <= mBounds.size(); i++)
+			mCounts[ i ].store( 0, std::memory_order_relaxed );
+	}
+	
+	void Stats::Histogram::record(double value)
+	{
+		size_t bucket = std::lower_bound( mBounds.begin(), mBounds.end(), value ) - mBounds.begin();
+		mCounts[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+		mCount.fetch_add( 1, std::memory_order_relaxed );
+		// Single writer, so load and store need no compare-exchange:
+		mSum.store( mSum.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+	}
+	
+	Stats::HistogramSnapshot Stats::Histogram::snapshot() const
+	{
+		HistogramSnapshot result;
+		result.bounds = mBounds;
+		result.counts.resize( mBounds.size() + 1 );
+		for(size_t i = 0; i <= mBounds.size(); i++)
+			result.counts[ i ] = mCounts[ i ].load( std::memory_order_relaxed );
+		result.count = mCount.load( std::memory_order_relaxed );
+		result.sum = mSum.load( std::memory_order_relaxed );
+		return result;
+	}
+	
+	Stats::Stats() :
+		mUtterances( 0 ),
+		mDiscarded( 0 ),
+		mCut( 0 ),
+		mBlocks( 0 ),
+		mSamples( 0 ),
+		mFrames( 0 ),
+		mDroppedBlocks( 0 ),
+		mDroppedSamples( 0 ),
+		mQueueDepth( 0 ),
+		mMaxQueueDepth( 0 ),
+		mSpeechSeconds( 0.0 ),
+		mCpuSeconds( 0.0 ),
+		mWallSeconds( 0.0 ),
+		mUttSpeech( { 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0 } ),
+		mUttCpu( { 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0 } ),
+		mUttWall( { 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0 } ),
+		mRtf( { 0.05, 0.1, 0.2, 0.3, 0.5, 0.75, 1.0, 1.5, 2.0 } ),
+		mLatencyMs( { 1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0 } )
+	{
+		mThreadPolicy.scheduler = ThreadPolicy::Scheduler::Default;
+		mThreadPolicy.priority = 0;
+		mThreadPolicy.nice = 0;
+		mThreadPolicy.named = false;
+	}
+	
+	void Stats::recordThreadPolicy(const ThreadPolicy::Result& policy)
+	{
+		std::lock_guard<std::mutex> lock( mPolicyMutex );
+		mThreadPolicy = policy;
+	}
+	
+	void Stats::recordDrop(size_t blocks, size_t samples)
+	{
+		mDroppedBlocks.fetch_add( blocks, std::memory_order_relaxed );
+		mDroppedSamples.fetch_add( samples, std::memory_order_relaxed );
+	}
+	
+	void Stats::recordQueueDepth(size_t samples)
+	{
+		mQueueDepth.store( samples, std::memory_order_relaxed );
+		if( samples > mMaxQueueDepth.load( std::memory_order_relaxed ) )
+			mMaxQueueDepth.store( samples, std::memory_order_relaxed );
+	}
+	
+	void Stats::recordUtterance(bool cut, int frames, double speech, double cpu, double wall, double latencyMs)
+	{
+		mUtterances.fetch_add( 1, std::memory_order_relaxed );
+		if( cut )
+			mCut.fetch_add( 1, std::memory_order_relaxed );
+		mFrames.fetch_add( std::max( frames, 0 ), std::memory_order_relaxed );
+		
+		mUttSpeech.record( speech );
+		mUttCpu.record( cpu );
+		mUttWall.record( wall );
+		if( speech > 0.0 )
+			mRtf.record( cpu / speech );
+		mLatencyMs.record( latencyMs );
+	}
+	
+	void Stats::recordTotals(double speech, double cpu, double wall)
+	{
+		mSpeechSeconds.store( speech, std::memory_order_relaxed );
+		mCpuSeconds.store( cpu, std::memory_order_relaxed );
+		mWallSeconds.store( wall, std::memory_order_relaxed );
+	}
+	
+	Stats::Snapshot Stats::snapshot() const
+	{
+		Snapshot result;
+		result.utterances		= mUtterances.load( std::memory_order_relaxed );
+		result.discarded		= mDiscarded.load( std::memory_order_relaxed );
+		result.cut				= mCut.load( std::memory_order_relaxed );
+		result.blocks			= mBlocks.load( std::memory_order_relaxed );
+		result.samples			= mSamples.load( std::memory_order_relaxed );
+		result.frames			= mFrames.load( std::memory_order_relaxed );
+		result.droppedBlocks	= mDroppedBlocks.load( std::memory_order_relaxed );
+		result.droppedSamples	= mDroppedSamples.load( std::memory_order_relaxed );
+		result.queueDepth		= mQueueDepth.load( std::memory_order_relaxed );
+		result.maxQueueDepth	= mMaxQueueDepth.load( std::memory_order_relaxed );
+		result.speechSeconds	= mSpeechSeconds.load( std::memory_order_relaxed );
+		result.cpuSeconds		= mCpuSeconds.load( std::memory_order_relaxed );
+		result.wallSeconds		= mWallSeconds.load( std::memory_order_relaxed );
+		result.uttSpeech		= mUttSpeech.snapshot();
+		result.uttCpu			= mUttCpu.snapshot();
+		result.uttWall			= mUttWall.snapshot();
+		result.rtf				= mRtf.snapshot();
+		result.latencyMs		= mLatencyMs.snapshot();
+		
+		std::lock_guard<std::mutex> lock( mPolicyMutex );
+		result.threadPolicy		= mThreadPolicy;
+		return result;
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,153 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/ThreadPolicy.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#if defined( __linux__ )
+	#include <sys/syscall.h>
+#endif
+
+namespace sphinx {
+	
+	static void appendError(std::string* errors, const std::string& setting, int err)
+	{
+		if( ! errors->empty() )
+			*errors += "; ";
+		*errors += setting + ": " + ( err ? strerror( err ) : "unsupported on this platform" );
+	}
+	
+	ThreadPolicy::Result ThreadPolicy::apply() const
+	{
+		Result result;
+		result.named = false;
+		
+		// Name, limited to 15 characters by Linux:
+		if( ! mName.empty() ) {
+			std::string name = mName.substr( 0, 15 );
+#if defined( __APPLE__ )
+			int err = pthread_setname_np( name.c_str() );
+#else
+			int err = pthread_setname_np( pthread_self(), name.c_str() );
+#endif
+			result.named = err == 0;
+			if( err )
+				appendError( &result.errors, "name", err );
+		}
+		
+		// Real-time scheduling, usually needing privileges or an rtprio limit:
+		if( mScheduler != Scheduler::Default ) {
+			int policy = mScheduler == Scheduler::Fifo ? SCHED_FIFO : SCHED_RR;
+			struct sched_param param;
+			memset( &param, 0, sizeof( param ) );
+			param.sched_priority = std::max( sched_get_priority_min( policy ), std::min( sched_get_priority_max( policy ), mPriority ) );
+			int err = pthread_setschedparam( pthread_self(), policy, &param );
+			if( err )
+				appendError( &result.errors, toString( mScheduler ), err );
+		}
+		
+		// Nice level, which Linux applies per thread:
+		if( mSetNice ) {
+#if defined( __linux__ )
+			if( setpriority( PRIO_PROCESS, pid_t( syscall( SYS_gettid ) ), mNice ) != 0 )
+				appendError( &result.errors, "nice", errno );
+#else
+			appendError( &result.errors, "nice", 0 );
+#endif
+		}
+		
+		// CPU affinity:
+		if( ! mCpus.empty() ) {
+#if defined( __linux__ )
+			cpu_set_t set;
+			CPU_ZERO( &set );
+			for( int cpu : mCpus )
+				if( cpu >= 0 && cpu < CPU_SETSIZE )
+					CPU_SET( cpu, &set );
+			int err = pthread_setaffinity_np( pthread_self(), sizeof( set ), &set );
+			if( err )
+				appendError( &result.errors, "affinity", err );
+#else
+			appendError( &result.errors, "affinity", 0 );
+#endif
+		}
+		
+		// Read back what took effect:
+		int policy;
+		struct sched_param param;
+		if( pthread_getschedparam( pthread_self(), &policy, &param ) == 0 && ( policy == SCHED_FIFO || policy == SCHED_RR ) ) {
+			result.scheduler = policy == SCHED_FIFO ? Scheduler::Fifo : Scheduler::RoundRobin;
+			result.priority = param.sched_priority;
+		}
+		else {
+			result.scheduler = Scheduler::Default;
+			result.priority = 0;
+		}
+		
+#if defined( __linux__ )
+		errno = 0;
+		int nice = getpriority( PRIO_PROCESS, pid_t( syscall( SYS_gettid ) ) );
+		result.nice = errno == 0 ? nice : 0;
+		
+		cpu_set_t set;
+		if( pthread_getaffinity_np( pthread_self(), sizeof( set ), &set ) == 0 )
+			for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				if( CPU_ISSET( cpu, &set ) )
+					result.cpus.push_back( cpu );
+#else
+		errno = 0;
+		int nice = getpriority( PRIO_PROCESS, 0 );
+		result.nice = errno == 0 ? nice : 0;
+#endif
+		
+		return result;
+	}
+	
+	const char* ThreadPolicy::toString(Scheduler scheduler)
+	{
+		switch( scheduler ) {
+			case Scheduler::Fifo:		return "SCHED_FIFO";
+			case Scheduler::RoundRobin:	return "SCHED_RR";
+			default:					return "SCHED_OTHER";
+		}
+	}
+	
+	double ThreadPolicy::getThreadCpuSeconds()
+	{
+		struct timespec ts;
+		if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) != 0 )
+			return 0.0;
+		return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,336 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Trace.hpp"
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <condition_variable>
+
+namespace sphinx {
+	
+	/** @brief trace event as stored in ring */
+	struct TraceEvent
+	{
+		const char*		name;		//!< event name
+		uint64_t		time;		//!< start time
+		uint64_t		duration;	//!< duration, or counter value
+		uint32_t		session;	//!< session id
+		char			phase;		//!< Chrome event phase
+		char			arg[ 32 ];	//!< copied argument
+	};
+	
+	/** @brief single-producer single-consumer event ring owned by one thread at a time */
+	struct TraceRing
+	{
+		std::vector<TraceEvent>	events;		//!< storage, allocated once
+		std::atomic<size_t>		head;		//!< next write, advanced by owning thread
+		std::atomic<size_t>		tail;		//!< next read, advanced by flusher
+		uint32_t				tid;		//!< thread index, reused by later owners
+		std::atomic<const char*> name;		//!< owning thread's name, if set
+		std::atomic<uint32_t>	session;	//!< session owning thread was named in
+		const char*				writtenName;	//!< thread name last written by flusher
+		uint32_t				writtenSession;	//!< session of thread name last written by flusher
+		
+		TraceRing(size_t capacity, uint32_t id) : events( capacity ), head( 0 ), tail( 0 ), tid( id ), name( NULL ), session( 0 ), writtenName( NULL ), writtenSession( 0 ) { /* no-op */ }
+	};
+	
+	std::atomic<bool> Trace::sEnabled( false );
+	
+	//! registered rings, kept for the life of the process since threads hold raw pointers to them
+	static std::mutex							sRingMutex;
+	static std::vector<std::unique_ptr<TraceRing> >	sRings;
+	static size_t								sRingCapacity = 16384;
+	static const size_t							kMaxSpareRings = 8;
+	static std::atomic<TraceRing*>				sSpareRings[ kMaxSpareRings ];	//!< registered rings not yet claimed by a thread
+	static std::vector<TraceRing*>				sFreeRings;		//!< rings released by exited threads beyond the spare slots, under sRingMutex
+	static std::atomic<uint64_t>				sDropped( 0 );
+	static std::atomic<uint32_t>				sNextSession( 1 );
+	static const std::chrono::steady_clock::time_point sEpoch = std::chrono::steady_clock::now();
+	
+	//! flusher state
+	static std::mutex							sFlushMutex;
+	static std::condition_variable				sFlushCv;
+	static std::thread							sFlusher;
+	static bool									sFlusherStop = false;
+	static FILE*								sFile = NULL;
+	static bool									sFirstEvent = true;
+	
+	static thread_local TraceRing*				tRing = NULL;
+	static thread_local uint32_t				tSession = 0;
+	static thread_local const char*				tName = NULL;		//!< thread name, applied to ring once claimed
+	static thread_local uint32_t				tNameSession = 0;	//!< session thread was named in
+	
+	/** @brief returns thread's ring to the spare slots, or the free list if they are full, when the thread exits */
+	struct TraceRingOwner
+	{
+		~TraceRingOwner()
+		{
+			if( ! tRing )
+				return;
+			tRing->name.store( NULL, std::memory_order_release );
+			
+			// Undrained events stay in the ring and are still written:
+			for(size_t i = 0; i < kMaxSpareRings && tRing; i++) {
+				TraceRing* expected = NULL;
+				if( sSpareRings[ i ].compare_exchange_strong( expected, tRing, std::memory_order_release ) )
+					tRing = NULL;
+			}
+			if( tRing ) {
+				std::lock_guard<std::mutex> lock( sRingMutex );
+				sFreeRings.push_back( tRing );
+				tRing = NULL;
+			}
+		}
+	};
+	
+	static TraceRing* threadRing()
+	{
+		if( ! tRing ) {
+			// Claim a spare ring first, so real-time threads neither allocate nor lock:
+			for(size_t i = 0; i < kMaxSpareRings && ! tRing; i++)
+				tRing = sSpareRings[ i ].exchange( NULL, std::memory_order_acquire );
+			
+			// Otherwise reuse a released ring or register a new one, the only locking on the producer side:
+			if( ! tRing ) {
+				std::lock_guard<std::mutex> lock( sRingMutex );
+				if( ! sFreeRings.empty() ) {
+					tRing = sFreeRings.back();
+					sFreeRings.pop_back();
+				}
+				else {
+					sRings.push_back( std::unique_ptr<TraceRing>( new TraceRing( sRingCapacity, uint32_t( sRings.size() + 1 ) ) ) );
+					tRing = sRings.back().get();
+				}
+			}
+			
+			// Hand ring back when thread exits:
+			static thread_local TraceRingOwner tOwner;
+			(void)tOwner;
+			
+			tRing->session = tNameSession;
+			tRing->name.store( tName, std::memory_order_release );
+		}
+		return tRing;
+	}
+	
+	static void push(const char* name, char phase, uint64_t time, uint64_t duration, const char* arg)
+	{
+		TraceRing* ring = threadRing();
+		size_t head = ring->head.load( std::memory_order_relaxed );
+		if( head - ring->tail.load( std::memory_order_acquire ) >= ring->events.size() ) {
+			sDropped.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+		
+		TraceEvent& e = ring->events[ head % ring->events.size() ];
+		e.name     = name;
+		e.time     = time;
+		e.duration = duration;
+		e.session  = tSession;
+		e.phase    = phase;
+		if( arg ) {
+			strncpy( e.arg, arg, sizeof( e.arg ) - 1 );
+			e.arg[ sizeof( e.arg ) - 1 ] = '\0';
+		}
+		else {
+			e.arg[ 0 ] = '\0';
+		}
+		ring->head.store( head + 1, std::memory_order_release );
+	}
+	
+	static void writeEscaped(const char* str)
+	{
+		for(; *str; str++) {
+			if( *str == '"' || *str == '\\' )
+				fputc( '\\', sFile );
+			if( (unsigned char)( *str ) >= 0x20 )
+				fputc( *str, sFile );
+		}
+	}
+	
+	static void drain()
+	{
+		std::lock_guard<std::mutex> lock( sRingMutex );
+		for( auto& ring : sRings ) {
+			// Name thread once per owner:
+			const char* name = ring->name.load( std::memory_order_acquire );
+			uint32_t session = ring->session.load();
+			if( name && ( name != ring->writtenName || session != ring->writtenSession ) ) {
+				fprintf( sFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"", sFirstEvent ? "" : ",\n", session, ring->tid );
+				writeEscaped( name );
+				fputs( "\"}}", sFile );
+				sFirstEvent = false;
+				ring->writtenName = name;
+				ring->writtenSession = session;
+			}
+			
+			size_t tail = ring->tail.load( std::memory_order_relaxed );
+			size_t head = ring->head.load( std::memory_order_acquire );
+			for(; tail != head; tail++) {
+				const TraceEvent& e = ring->events[ tail % ring->events.size() ];
+				fprintf( sFile, "%s{\"name\":\"", sFirstEvent ? "" : ",\n" );
+				writeEscaped( e.name );
+				fprintf( sFile, "\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%u,\"tid\":%u", e.phase, (unsigned long long)e.time, e.session, ring->tid );
+				if( e.phase == 'X' )
+					fprintf( sFile, ",\"dur\":%llu", (unsigned long long)e.duration );
+				else if( e.phase == 'C' )
+					fprintf( sFile, ",\"args\":{\"value\":%lld}", (long long)int64_t( e.duration ) );
+				else if( e.phase == 'i' ) {
+					fputs( ",\"s\":\"t\"", sFile );
+					if( e.arg[ 0 ] ) {
+						fputs( ",\"args\":{\"value\":\"", sFile );
+						writeEscaped( e.arg );
+						fputs( "\"}", sFile );
+					}
+				}
+				fputc( '}', sFile );
+				sFirstEvent = false;
+			}
+			ring->tail.store( tail, std::memory_order_release );
+		}
+	}
+	
+	void Trace::start(const ci::fs::path& jsonPath, size_t ringCapacity, size_t spareRings)
+	{
+		stop();
+		
+		std::lock_guard<std::mutex> lock( sFlushMutex );
+		sFile = fopen( jsonPath.c_str(), "w" );
+		if( ! sFile )
+			throw std::runtime_error( "Could not write trace: \"" + jsonPath.string() + "\"" );
+		fputs( "[\n", sFile );
+		sFirstEvent = true;
+		{
+			std::lock_guard<std::mutex> ringLock( sRingMutex );
+			sRingCapacity = ringCapacity > 0 ? ringCapacity : 1;
+			for( auto& ring : sRings )
+				ring->writtenName = NULL;
+			
+			// Top up spare rings for threads that first trace from a callback:
+			for(size_t i = 0; i < std::min( spareRings, kMaxSpareRings ); i++) {
+				if( sSpareRings[ i ].load( std::memory_order_relaxed ) )
+					continue;
+				if( sFreeRings.empty() ) {
+					sRings.push_back( std::unique_ptr<TraceRing>( new TraceRing( sRingCapacity, uint32_t( sRings.size() + 1 ) ) ) );
+					sFreeRings.push_back( sRings.back().get() );
+				}
+				
+				// An exiting thread may have filled the slot meanwhile:
+				TraceRing* expected = NULL;
+				if( sSpareRings[ i ].compare_exchange_strong( expected, sFreeRings.back(), std::memory_order_release ) )
+					sFreeRings.pop_back();
+			}
+		}
+		
+		// Flush periodically off the hot path:
+		sFlusherStop = false;
+		sFlusher = std::thread( []() {
+			std::unique_lock<std::mutex> flushLock( sFlushMutex );
+			while( ! sFlusherStop ) {
+				sFlushCv.wait_for( flushLock, std::chrono::milliseconds( 50 ) );
+				drain();
+			}
+		} );
+		sEnabled = true;
+	}
+	
+	void Trace::stop()
+	{
+		sEnabled = false;
+		
+		{
+			std::lock_guard<std::mutex> lock( sFlushMutex );
+			sFlusherStop = true;
+		}
+		sFlushCv.notify_all();
+		if( sFlusher.joinable() )
+			sFlusher.join();
+		
+		std::lock_guard<std::mutex> lock( sFlushMutex );
+		if( sFile ) {
+			drain();
+			fputs( "\n]\n", sFile );
+			fclose( sFile );
+			sFile = NULL;
+		}
+	}
+	
+	uint64_t Trace::now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - sEpoch ).count();
+	}
+	
+	void Trace::complete(const char* name, uint64_t beginUs, uint64_t durationUs)
+	{
+		if( isEnabled() )
+			push( name, 'X', beginUs, durationUs, NULL );
+	}
+	
+	void Trace::instant(const char* name, const char* arg)
+	{
+		if( isEnabled() )
+			push( name, 'i', now(), 0, arg );
+	}
+	
+	void Trace::counter(const char* name, int64_t value)
+	{
+		if( isEnabled() )
+			push( name, 'C', now(), uint64_t( value ), NULL );
+	}
+	
+	uint32_t Trace::newSession()
+	{
+		return sNextSession++;
+	}
+	
+	void Trace::setSession(uint32_t session)
+	{
+		tSession = session;
+	}
+	
+	void Trace::setThreadName(const char* name)
+	{
+		// Threads that never trace never claim a ring:
+		tName = name;
+		tNameSession = tSession;
+		if( tRing ) {
+			tRing->session = tSession;
+			tRing->name.store( name, std::memory_order_release );
+		}
+	}
+	
+	uint64_t Trace::getDroppedEvents()
+	{
+		return sDropped.load( std::memory_order_relaxed );
+	}
+	
+} // namespace sphinx
@@ -0,0 +1,290 @@
+/*
+ Copyright (c) 2015, Patrick J. Hebron
+ All rights reserved.
+ 
+ http://patrickhebron.com
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and
+	the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+	the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sphinx/Tuner.hpp"
+#include "sphinx/Recognizer.hpp"
+#include "sphinx/ThreadPolicy.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace sphinx {
+	
+	//! decoder input block size (100 ms at 16 kHz), matching live streaming granularity
+	static const size_t kTunerBlockSize = 1600;
+	
+	static std::vector<std::string> splitWords(const std::string& text)
+	{
+		std::vector<std::string> words;
+		std::istringstream ss( text );
+		std::string word;
+		while( ss >> word )
+			words.push_back( word );
+		return words;
+	}
+	
+	static size_t editDistance(const std::vector<std::string>& ref, const std::vector<std::string>& hyp)
+	{
+		// Levenshtein distance over words, single row:
+		std::vector<size_t> row( hyp.size() + 1 );
+		for(size_t j = 0; j <= hyp.size(); j++)
+			row[ j ] = j;
+		for(size_t i = 1; i <= ref.size(); i++) {
+			size_t diag = row[ 0 ];
+			row[ 0 ] = i;
+			for(size_t j = 1; j <= hyp.size(); j++) {
+				size_t up = row[ j ];
+				row[ j ] = std::min( std::min( row[ j ] + 1, row[ j - 1 ] + 1 ), diag + ( ref[ i - 1 ] == hyp[ j - 1 ] ? 0 : 1 ) );
+				diag = up;
+			}
+		}
+		return row[ hyp.size() ];
+	}
+	
+	void Tuner::loadAudio(const ci::fs::path& audioPath, std::vector<int16_t>* samples)
+	{
+		std::ifstream fh( audioPath.c_str(), std::ios::binary );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load audio: \"" + audioPath.string() + "\"" );
+		
+		std::string data( ( std::istreambuf_iterator<char>( fh ) ), std::istreambuf_iterator<char>() );
+		size_t begin = 0, end = data.size();
+		
+		// Locate data chunk of WAV files, otherwise treat as headerless PCM:
+		if( data.size() >= 12 && data.compare( 0, 4, "RIFF" ) == 0 && data.compare( 8, 4, "WAVE" ) == 0 ) {
+			size_t pos = 12;
+			end = 0;
+			while( pos + 8 <= data.size() ) {
+				uint32_t chunkSize;
+				memcpy( &chunkSize, &data[ pos + 4 ], sizeof( chunkSize ) );
+				if( data.compare( pos, 4, "data" ) == 0 ) {
+					begin = pos + 8;
+					end = std::min( data.size(), begin + chunkSize );
+					break;
+				}
+				pos += 8 + chunkSize + ( chunkSize & 1 );
+			}
+		}
+		
+		samples->resize( ( end - begin ) / sizeof( int16_t ) );
+		if( ! samples->empty() )
+			memcpy( samples->data(), data.data() + begin, samples->size() * sizeof( int16_t ) );
+	}
+	
+	Tuner::Tuner(const RecognizerConfig& base, const std::string& jsgfData) :
+		mBase( base ),
+		mJsgf( jsgfData ),
+		mNumThreads( std::max( 1u, std::thread::hardware_concurrency() ) )
+	{
+		/* no-op */
+	}
+	
+	Tuner& Tuner::corpus(const ci::fs::path& listPath)
+	{
+		std::ifstream fh( listPath.c_str() );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not load corpus: \"" + listPath.string() + "\"" );
+		
+		std::string line;
+		while( std::getline( fh, line ) ) {
+			size_t tab = line.find( '\t' );
+			if( line.empty() || line[ 0 ] == '#' || tab == std::string::npos )
+				continue;
+			ci::fs::path audioPath( line.substr( 0, tab ) );
+			if( ! audioPath.is_absolute() )
+				audioPath = listPath.parent_path() / audioPath;
+			add( audioPath, line.substr( tab + 1 ) );
+		}
+		
+		return *this;
+	}
+	
+	Tuner& Tuner::add(const ci::fs::path& audioPath, const std::string& reference)
+	{
+		Utterance utt;
+		utt.audioPath = audioPath;
+		utt.reference = reference;
+		loadAudio( audioPath, &utt.samples );
+		mCorpus.push_back( std::move( utt ) );
+		return *this;
+	}
+	
+	std::vector<Tuner::Result> Tuner::expandGrid() const
+	{
+		std::vector<Result> grid( 1 );
+		grid[ 0 ].config = mBase;
+		
+		// Multiply grid by each non-empty axis:
+		auto expand = [&grid](size_t count, const std::function<void(Result*, size_t)>& apply) {
+			if( count == 0 )
+				return;
+			std::vector<Result> next;
+			for( const auto& point : grid ) {
+				for(size_t i = 0; i < count; i++) {
+					next.push_back( point );
+					apply( &next.back(), i );
+				}
+			}
+			grid.swap( next );
+		};
+		
+		auto label = [](Result* r, const std::string& name, const std::string& value) {
+			r->label += ( r->label.empty() ? "" : " " ) + name + "=" + value;
+		};
+		auto str = [](double value) { std::ostringstream ss; ss << value; return ss.str(); };
+		
+		expand( mBeams.size(), [&](Result* r, size_t i) { r->config.beam( mBeams[ i ] ); label( r, "beam", str( mBeams[ i ] ) ); } );
+		expand( mWbeams.size(), [&](Result* r, size_t i) { r->config.wbeam( mWbeams[ i ] ); label( r, "wbeam", str( mWbeams[ i ] ) ); } );
+		expand( mMaxhmmpfs.size(), [&](Result* r, size_t i) { r->config.maxhmmpf( mMaxhmmpfs[ i ] ); label( r, "maxhmmpf", str( mMaxhmmpfs[ i ] ) ); } );
+		expand( mDss.size(), [&](Result* r, size_t i) { r->config.ds( mDss[ i ] ); label( r, "ds", str( mDss[ i ] ) ); } );
+		expand( mTopns.size(), [&](Result* r, size_t i) { r->config.topn( mTopns[ i ] ); label( r, "topn", str( mTopns[ i ] ) ); } );
+		expand( mPlWindows.size(), [&](Result* r, size_t i) { r->config.plWindow( mPlWindows[ i ] ); label( r, "pl_window", str( mPlWindows[ i ] ) ); } );
+		
+		for( auto& point : grid ) {
+			if( point.label.empty() )
+				point.label = "base";
+			point.rtf = point.latencyMs = point.wer = 0.0;
+			point.pareto = false;
+		}
+		
+		return grid;
+	}
+	
+	void Tuner::evaluate(Result* result) const
+	{
+		RecognizerRef recognizer = Recognizer::create( result->config );
+		recognizer->addModelJsgf( "tuner", mJsgf, true );
+		ps_decoder_t* decoder = recognizer->getDecoder();
+		
+		double cpuTotal = 0.0, audioTotal = 0.0, latencyTotal = 0.0;
+		size_t edits = 0, refWords = 0;
+		
+		for( const auto& utt : mCorpus ) {
+			if( ps_start_utt( decoder ) < 0 )
+				throw std::runtime_error( "Could not start utterance" );
+			
+			// Feed in live-sized blocks, timing this thread only since other workers decode concurrently:
+			double cpuBegin = ThreadPolicy::getThreadCpuSeconds();
+			for(size_t pos = 0; pos < utt.samples.size(); pos += kTunerBlockSize)
+				ps_process_raw( decoder, utt.samples.data() + pos, std::min( kTunerBlockSize, utt.samples.size() - pos ), false, false );
+			
+			// Time finalization, which is what follows end of speech in live use:
+			auto endBegin = std::chrono::steady_clock::now();
+			ps_end_utt( decoder );
+			const char* hyp = ps_get_hyp( decoder, NULL );
+			auto endFinish = std::chrono::steady_clock::now();
+			double cpu = ThreadPolicy::getThreadCpuSeconds() - cpuBegin;
+			
+			std::vector<std::string> refTokens = splitWords( utt.reference );
+			
+			cpuTotal     += cpu;
+			audioTotal   += utt.samples.size() / 16000.0;
+			latencyTotal += std::chrono::duration<double,std::milli>( endFinish - endBegin ).count();
+			edits        += editDistance( refTokens, splitWords( hyp ? hyp : "" ) );
+			refWords     += refTokens.size();
+		}
+		
+		result->rtf       = audioTotal > 0.0 ? cpuTotal / audioTotal : 0.0;
+		result->latencyMs = mCorpus.empty() ? 0.0 : latencyTotal / mCorpus.size();
+		result->wer       = refWords > 0 ? double( edits ) / refWords : 0.0;
+	}
+	
+	std::vector<Tuner::Result> Tuner::run() const
+	{
+		if( mCorpus.empty() )
+			throw std::runtime_error( "Could not run tuner: corpus is empty" );
+		
+		std::vector<Result> results = expandGrid();
+		std::atomic<size_t> next( 0 );
+		std::exception_ptr error;
+		std::mutex errorMutex;
+		
+		// Workers pull grid points until exhausted, each with its own decoder:
+		auto worker = [&]() {
+			for(size_t i = next++; i < results.size(); i = next++) {
+				try {
+					evaluate( &results[ i ] );
+				}
+				catch( ... ) {
+					std::lock_guard<std::mutex> lock( errorMutex );
+					if( ! error )
+						error = std::current_exception();
+				}
+			}
+		};
+		
+		std::vector<std::thread> workers;
+		for(size_t i = 0; i < std::min( mNumThreads, results.size() ); i++)
+			workers.push_back( std::thread( worker ) );
+		for( auto& w : workers )
+			w.join();
+		
+		if( error )
+			std::rethrow_exception( error );
+		
+		markPareto( &results );
+		return results;
+	}
+	
+	void Tuner::markPareto(std::vector<Result>* results)
+	{
+		for( auto& a : *results ) {
+			a.pareto = true;
+			for( const auto& b : *results ) {
+				bool noWorse = b.rtf <= a.rtf && b.latencyMs <= a.latencyMs && b.wer <= a.wer;
+				bool better  = b.rtf < a.rtf || b.latencyMs < a.latencyMs || b.wer < a.wer;
+				if( noWorse && better ) {
+					a.pareto = false;
+					break;
+				}
+			}
+		}
+	}
+	
+	void Tuner::writeReport(const std::vector<Result>& results, const ci::fs::path& csvPath)
+	{
+		std::ofstream fh( csvPath.c_str(), std::ios::trunc );
+		if( ! fh.is_open() )
+			throw std::runtime_error( "Could not write tuner report: \"" + csvPath.string() + "\"" );
+		
+		fh << "label,rtf,latency_ms,wer,pareto\n";
+		for( const auto& r : results )
+			fh << "\"" << r.label << "\"," << r.rtf << "," << r.latencyMs << "," << r.wer << "," << ( r.pareto ? 1 : 0 ) << "\n";
+	}
+	
+	double Tuner::wordErrorRate(const std::string& reference, const std::string& hypothesis)
+	{
+		std::vector<std::string> ref = splitWords( reference );
+		return ref.empty() ? 0.0 : double( editDistance( ref, splitWords( hypothesis ) ) ) / ref.size();
+	}
+	
+} // namespace sphinx